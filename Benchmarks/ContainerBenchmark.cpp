@@ -0,0 +1,146 @@
+/*
+	Container-heavy workloads on the global heap (new/delete) versus memory manager arenas through
+	std::pmr (MemoryManagerResource) and through the typed ManagerAllocator.
+	Build: g++ -std=c++17 -O2 -pthread Benchmarks/ContainerBenchmark.cpp MemoryManager/MemoryManager.cpp MemoryManager/HoleIndex.cpp MemoryManager/HoleKernels.cpp MemoryManager/AllocationTrace.cpp MemoryManager/MemoryMapWriter.cpp MemoryManager/RunLengthMap.cpp MemoryManager/HeapProfiler.cpp
+*/
+
+#include "../MemoryManager/MemoryResource.h"
+#include <chrono>
+#include <map>
+#include <unordered_map>
+#include <iomanip>
+
+#define WORD_SIZE 16
+#define ARENA_WORDS 65535 //largest arena whose hole sizes fit the 16-bit getList() format
+#define REPEATS 20
+
+typedef BasicMemoryManager<FirstFitPolicy, WORD_SIZE> FirstFitManager;
+
+//Every workload builds its containers from a source of allocators, runs some churn and returns a checksum
+struct DefaultHeap
+{
+	template<class T> std::allocator<T> get() { return std::allocator<T>(); }
+};
+struct PmrArena
+{
+	PmrArena(std::pmr::memory_resource* resource) : resource(resource) {}
+	template<class T> std::pmr::polymorphic_allocator<T> get() { return std::pmr::polymorphic_allocator<T>(this->resource); }
+	std::pmr::memory_resource* resource;
+};
+struct TypedArena
+{
+	TypedArena(FirstFitManager& manager) : manager(&manager) {}
+	template<class T> ManagerAllocator<T, FirstFitManager> get() { return ManagerAllocator<T, FirstFitManager>(*this->manager); }
+	FirstFitManager* manager;
+};
+
+template<class Source>
+size_t vectorGrowth(Source& source)
+{
+	//repeated push_back growth: one reallocation per doubling
+	size_t checksum = 0;
+	for (int r = 0; r < REPEATS; r++)
+	{
+		vector<int, decltype(source.template get<int>())> values(source.template get<int>());
+		for (int i = 0; i < 20000; i++)
+			values.push_back(i);
+		checksum += values.back();
+	}
+	return checksum;
+}
+template<class Source>
+size_t hashMapChurn(Source& source)
+{
+	//insert, erase every other key, insert again: node allocations and bucket array rehashes
+	typedef decltype(source.template get<pair<const int, int>>()) Allocator;
+	size_t checksum = 0;
+	for (int r = 0; r < REPEATS; r++)
+	{
+		unordered_map<int, int, hash<int>, equal_to<int>, Allocator> table(16, hash<int>(), equal_to<int>(), source.template get<pair<const int, int>>());
+		for (int i = 0; i < 4000; i++)
+			table[i * 7919] = i;
+		for (int i = 0; i < 4000; i += 2)
+			table.erase(i * 7919);
+		for (int i = 0; i < 4000; i += 2)
+			table[i * 7919 + 1] = i;
+		checksum += table.size();
+	}
+	return checksum;
+}
+template<class Source>
+size_t treeMapChurn(Source& source)
+{
+	//ordered map with pseudo-random keys: many small, interleaved node allocations and frees
+	typedef decltype(source.template get<pair<const int, int>>()) Allocator;
+	size_t checksum = 0;
+	for (int r = 0; r < REPEATS; r++)
+	{
+		map<int, int, less<int>, Allocator> tree(less<int>(), source.template get<pair<const int, int>>());
+		unsigned key = 12345;
+		for (int i = 0; i < 4000; i++)
+		{
+			key = key * 1103515245 + 12345;
+			tree[key % 100000] = i;
+			if (i % 3 == 0)
+				tree.erase(tree.begin());
+		}
+		checksum += tree.size();
+	}
+	return checksum;
+}
+
+template<class Source>
+void runWorkloads(const char* name, Source& source)
+{
+	const char* workloads[] = { "vector growth", "unordered_map churn", "map churn" };
+	for (int w = 0; w < 3; w++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		size_t checksum = 0;
+		try
+		{
+			if (w == 0)
+				checksum = vectorGrowth(source);
+			else if (w == 1)
+				checksum = hashMapChurn(source);
+			else
+				checksum = treeMapChurn(source);
+		}
+		catch (const std::bad_alloc&)
+		{
+			cout << left << setw(34) << name << setw(22) << workloads[w] << "arena full" << endl;
+			continue;
+		}
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		cout << left << setw(34) << name << setw(22) << workloads[w] << right << fixed << setprecision(2) << setw(10) << ms << " ms  (checksum " << checksum << ")" << endl;
+	}
+}
+
+int main()
+{
+	DefaultHeap heap;
+	runWorkloads("new/delete", heap);
+
+	MemoryManager callbackManager(WORD_SIZE, firstFit);
+	callbackManager.initialize(ARENA_WORDS);
+	MemoryManagerResource<MemoryManager> callbackResource(callbackManager);
+	PmrArena callbackArena(&callbackResource);
+	runWorkloads("pmr, MemoryManager(firstFit)", callbackArena);
+
+	MemoryManager bestFitManager(WORD_SIZE, bestFit);
+	bestFitManager.initialize(ARENA_WORDS);
+	MemoryManagerResource<MemoryManager> bestFitResource(bestFitManager);
+	PmrArena bestFitArena(&bestFitResource);
+	runWorkloads("pmr, MemoryManager(bestFit)", bestFitArena);
+
+	FirstFitManager policyManager;
+	policyManager.initialize(ARENA_WORDS);
+	MemoryManagerResource<FirstFitManager> policyResource(policyManager);
+	PmrArena policyArena(&policyResource);
+	runWorkloads("pmr, BasicMemoryManager<FirstFit>", policyArena);
+
+	TypedArena typedArena(policyManager);
+	runWorkloads("ManagerAllocator<FirstFit>", typedArena);
+
+	return 0;
+}
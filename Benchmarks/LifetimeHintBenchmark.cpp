@@ -0,0 +1,85 @@
+/*
+	Fragmentation with and without lifetime hints. Records a workload where bursts of short-lived
+	allocations are interleaved with a few long-lived ones, then replays the trace with bestFit and
+	worstFit, once ignoring the hints and once honouring them.
+	Build: g++ -std=c++17 -O2 -pthread Benchmarks/LifetimeHintBenchmark.cpp MemoryManager/MemoryManager.cpp MemoryManager/HoleIndex.cpp MemoryManager/HoleKernels.cpp MemoryManager/AllocationTrace.cpp MemoryManager/MemoryMapWriter.cpp MemoryManager/RunLengthMap.cpp MemoryManager/HeapProfiler.cpp
+*/
+
+#include "../MemoryManager/AllocationTrace.h"
+#include <iomanip>
+
+#define WORD_SIZE 8
+#define RECORD_WORDS 65535 //roomy arena for recording, so the trace itself has no failures
+#define REPLAY_WORDS 6000
+#define ROUNDS 400
+#define SAMPLE_INTERVAL 200
+
+void recordWorkload(char* filename)
+{
+	MemoryManager memoryManager(WORD_SIZE, firstFit);
+	memoryManager.setMetadataOnly(true);
+	memoryManager.initialize(RECORD_WORDS);
+	memoryManager.startTrace(filename);
+
+	vector<void*> longLived;
+	unsigned seed = 12345;
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		//a burst of short-lived requests, all freed by the end of the round
+		vector<void*> burst;
+		for (int i = 0; i < 24; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			burst.push_back(memoryManager.allocate(WORD_SIZE * (4 + (seed >> 16) % 60)));
+		}
+		//one long-lived allocation per round; the oldest ones eventually go away
+		seed = seed * 1103515245 + 12345;
+		longLived.push_back(memoryManager.allocate(WORD_SIZE * (2 + (seed >> 16) % 14), LIFETIME_LONG));
+		if (longLived.size() > 64)
+		{
+			memoryManager.free(longLived.front());
+			longLived.erase(longLived.begin());
+		}
+		for (size_t i = 0; i < burst.size(); i++)
+			memoryManager.free(burst[i]);
+	}
+
+	memoryManager.stopTrace();
+	memoryManager.shutdown();
+}
+
+void printRow(const char* strategy, bool useHints, const ReplayReport& report)
+{
+	double total = 0, worst = 0;
+	for (size_t i = 0; i < report.fragmentation.size(); i++)
+	{
+		total += report.fragmentation[i].fragmentation;
+		worst = max(worst, report.fragmentation[i].fragmentation);
+	}
+	double average = report.fragmentation.empty() ? 0 : total / report.fragmentation.size();
+	cout << left << setw(10) << strategy << setw(8) << (useHints ? "yes" : "no") << right << fixed << setprecision(3)
+		<< setw(12) << average << setw(12) << worst << setw(10) << report.failures << endl;
+}
+
+int main()
+{
+	char filename[] = "lifetimeHints.trace";
+	recordWorkload(filename);
+
+	vector<uint8_t> trace;
+	if (loadTrace(filename, trace) == -1)
+	{
+		cout << "could not read " << filename << endl;
+		return 1;
+	}
+
+	cout << left << setw(10) << "strategy" << setw(8) << "hints" << right << setw(12) << "avg frag" << setw(12) << "max frag" << setw(10) << "failures" << endl;
+	const char* names[] = { "bestFit", "worstFit" };
+	int (*allocators[])(int, void*) = { bestFit, worstFit };
+	for (int a = 0; a < 2; a++)
+		for (int hints = 0; hints < 2; hints++)
+			printRow(names[a], hints, replayTrace(trace.data(), trace.size(), WORD_SIZE, REPLAY_WORDS, allocators[a], SAMPLE_INTERVAL, hints));
+
+	unlink(filename);
+	return 0;
+}
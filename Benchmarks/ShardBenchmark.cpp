@@ -0,0 +1,71 @@
+/*
+	Allocation throughput as threads are added: one MemoryManager behind a single lock versus a
+	ShardedMemoryManager with one arena per thread.
+	Build: g++ -std=c++17 -O2 -pthread Benchmarks/ShardBenchmark.cpp MemoryManager/MemoryManager.cpp MemoryManager/HoleIndex.cpp MemoryManager/HoleKernels.cpp MemoryManager/AllocationTrace.cpp MemoryManager/MemoryMapWriter.cpp MemoryManager/RunLengthMap.cpp MemoryManager/HeapProfiler.cpp MemoryManager/ShardedMemoryManager.cpp
+*/
+
+#include "../MemoryManager/ShardedMemoryManager.h"
+#include <chrono>
+#include <thread>
+#include <iomanip>
+
+#define WORD_SIZE 8
+#define ARENA_WORDS 65535
+#define OPS_PER_THREAD 200000
+#define LIVE_BLOCKS 64
+
+//Single arena, every allocate/free takes the same lock
+struct LockedManager
+{
+	LockedManager() : manager(WORD_SIZE, firstFit) { this->manager.initialize(ARENA_WORDS); }
+	void* allocate(size_t bytes) { lock_guard<std::mutex> guard(this->lock); return this->manager.allocate(bytes); }
+	void free(void* p) { lock_guard<std::mutex> guard(this->lock); this->manager.free(p); }
+	MemoryManager manager;
+	std::mutex lock;
+};
+
+//Each thread keeps a ring of live blocks and replaces the oldest one on every step
+template<class Manager>
+double run(Manager& manager, unsigned threadCount)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<thread> threads;
+	for (unsigned t = 0; t < threadCount; t++)
+		threads.push_back(thread([&manager, t]()
+		{
+			void* live[LIVE_BLOCKS] = {};
+			unsigned seed = 17 + t;
+			for (int i = 0; i < OPS_PER_THREAD; i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				void*& slot = live[i % LIVE_BLOCKS];
+				if (slot)
+					manager.free(slot);
+				slot = manager.allocate(WORD_SIZE * (1 + (seed >> 16) % 16));
+			}
+			for (int i = 0; i < LIVE_BLOCKS; i++)
+				if (live[i])
+					manager.free(live[i]);
+		}));
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return 2.0 * OPS_PER_THREAD * threadCount / seconds;
+}
+
+int main()
+{
+	unsigned cores = thread::hardware_concurrency();
+	if (cores == 0)
+		cores = 1;
+
+	cout << setw(8) << "threads" << setw(18) << "one lock ops/s" << setw(18) << "sharded ops/s" << endl;
+	for (unsigned threads = 1; threads <= cores; threads *= 2)
+	{
+		LockedManager locked;
+		ShardedMemoryManager sharded(threads, WORD_SIZE, firstFit, SHARD_BY_THREAD);
+		sharded.initialize(ARENA_WORDS);
+		cout << setw(8) << threads << setw(18) << (size_t)run(locked, threads) << setw(18) << (size_t)run(sharded, threads) << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,324 @@
+#include "AllocationTrace.h"
+#include <sys/stat.h>
+#include <unordered_map>
+
+#define TRACE_BUFFER_BYTES (64 * 1024)
+
+//Little-endian field helpers so traces are portable between machines
+static void putLE(uint8_t* dest, uint64_t value, int width)
+{
+	for (int i = 0; i < width; i++)
+		dest[i] = (uint8_t)(value >> (8 * i));
+}
+static uint64_t getLE(const uint8_t* src, int width)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < width; i++)
+		value |= (uint64_t)src[i] << (8 * i);
+	return value;
+}
+
+//Trace recorder functions
+TraceRecorder::TraceRecorder()
+{
+	this->fd = -1;
+	this->nextLargeId = 0;
+}
+TraceRecorder::~TraceRecorder()
+{
+	close();
+}
+int TraceRecorder::open(char* filename, unsigned wordSize, unsigned sizeInWords)
+{
+	this->fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
+	if (this->fd == -1)
+		return -1;
+
+	uint8_t header[TRACE_HEADER_BYTES];
+	memcpy(header, TRACE_MAGIC, 4);
+	putLE(header + 4, TRACE_VERSION, 4);
+	putLE(header + 8, wordSize, 4);
+	putLE(header + 12, sizeInWords, 4);
+	this->buffer.reserve(TRACE_BUFFER_BYTES);
+	this->buffer.insert(this->buffer.end(), header, header + TRACE_HEADER_BYTES);
+	this->start = chrono::steady_clock::now();
+	return 0;
+}
+void TraceRecorder::recordAllocate(size_t sizeBytes, int offsetBytes, Lifetime hint)
+{
+	record(TRACE_ALLOCATE, sizeBytes, offsetBytes, hint);
+}
+void TraceRecorder::recordFree(size_t sizeBytes, int offsetBytes)
+{
+	record(TRACE_FREE, sizeBytes, offsetBytes, LIFETIME_SHORT);
+}
+void TraceRecorder::recordAllocateLarge(size_t sizeBytes, void* address, Lifetime hint)
+{
+	//address is nullptr if the mapping failed
+	int32_t id = -1;
+	if (address)
+	{
+		id = this->nextLargeId++;
+		this->largeIds[address] = id;
+	}
+	record(TRACE_ALLOCATE_LARGE, sizeBytes, id, hint);
+}
+void TraceRecorder::recordFreeLarge(size_t sizeBytes, void* address)
+{
+	map<void*, int32_t>::iterator object = this->largeIds.find(address);
+	if (object == this->largeIds.end())
+		return;
+	record(TRACE_FREE_LARGE, sizeBytes, object->second, LIFETIME_SHORT);
+	this->largeIds.erase(object);
+}
+int TraceRecorder::close()
+{
+	if (this->fd == -1)
+		return 0;
+	int result = flush();
+	if (::close(this->fd) == -1)
+		result = -1;
+	this->fd = -1;
+	return result;
+}
+void TraceRecorder::record(uint8_t op, size_t sizeBytes, int offsetBytes, uint8_t hint)
+{
+	if (this->fd == -1)
+		return;
+
+	uint64_t timestamp = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - this->start).count();
+	uint8_t entry[TRACE_RECORD_BYTES] = {};
+	putLE(entry, timestamp, 8);
+	putLE(entry + 8, (uint32_t)sizeBytes, 4);
+	putLE(entry + 12, (uint32_t)offsetBytes, 4);
+	entry[16] = op;
+	entry[17] = hint;
+	this->buffer.insert(this->buffer.end(), entry, entry + TRACE_RECORD_BYTES);
+
+	//Records are batched so tracing doesn't add a system call to every allocate/free
+	if (this->buffer.size() + TRACE_RECORD_BYTES > TRACE_BUFFER_BYTES)
+		flush();
+}
+int TraceRecorder::flush()
+{
+	size_t written = 0;
+	while (written < this->buffer.size())
+	{
+		ssize_t result = write(this->fd, this->buffer.data() + written, this->buffer.size() - written);
+		if (result == -1)
+		{
+			this->buffer.clear();
+			return -1;
+		}
+		written += result;
+	}
+	this->buffer.clear();
+	return 0;
+}
+
+//Trace parsing functions
+int loadTrace(char* filename, vector<uint8_t>& data)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1)
+		return -1;
+
+	struct stat info;
+	if (fstat(fd, &info) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+
+	data.resize(info.st_size);
+	size_t bytesRead = 0;
+	while (bytesRead < data.size())
+	{
+		ssize_t result = read(fd, data.data() + bytesRead, data.size() - bytesRead);
+		if (result <= 0)
+		{
+			close(fd);
+			return -1;
+		}
+		bytesRead += result;
+	}
+
+	if (close(fd) == -1)
+		return -1;
+	return 0;
+}
+bool readTraceHeader(const uint8_t* data, size_t length, TraceHeader& header)
+{
+	if (length < TRACE_HEADER_BYTES || memcmp(data, TRACE_MAGIC, 4) != 0)
+		return false;
+	header.version = (uint32_t)getLE(data + 4, 4);
+	header.wordSize = (uint32_t)getLE(data + 8, 4);
+	header.sizeInWords = (uint32_t)getLE(data + 12, 4);
+	return header.version == TRACE_VERSION;
+}
+size_t getTraceRecordCount(size_t length)
+{
+	if (length < TRACE_HEADER_BYTES)
+		return 0;
+	return (length - TRACE_HEADER_BYTES) / TRACE_RECORD_BYTES;
+}
+TraceRecord readTraceRecord(const uint8_t* data, size_t index)
+{
+	const uint8_t* entry = data + TRACE_HEADER_BYTES + index * TRACE_RECORD_BYTES;
+	TraceRecord record;
+	record.timestampNs = getLE(entry, 8);
+	record.sizeBytes = (uint32_t)getLE(entry + 8, 4);
+	record.offsetBytes = (int32_t)(uint32_t)getLE(entry + 12, 4);
+	record.op = entry[16];
+	record.hint = entry[17];
+	return record;
+}
+
+//Replay functions
+static FragmentationSample sampleFragmentation(MemoryManager& memoryManager, size_t operation)
+{
+	FragmentationSample sample = FragmentationSample();
+	sample.operation = operation;
+
+	uint16_t* list = (uint16_t*)memoryManager.getList();
+	//nothing allocated yet, the whole heap is a single hole
+	if (!list)
+	{
+		sample.freeBytes = memoryManager.getMemoryLimit();
+		sample.largestHoleBytes = sample.freeBytes;
+		return sample;
+	}
+
+	unsigned wordSize = memoryManager.getWordSize();
+	for (int i = 2; i <= list[0] * 2; i += 2)
+	{
+		size_t holeBytes = (size_t)list[i] * wordSize;
+		sample.freeBytes += holeBytes;
+		if (holeBytes > sample.largestHoleBytes)
+			sample.largestHoleBytes = holeBytes;
+	}
+	delete[] list;
+
+	if (sample.freeBytes)
+		sample.fragmentation = 1.0 - (double)sample.largestHoleBytes / sample.freeBytes;
+	return sample;
+}
+ReplayReport replayTrace(const uint8_t* data, size_t length, unsigned wordSize, size_t sizeInWords, std::function<int(int, void*)> allocator, size_t sampleInterval, bool useHints)
+{
+	ReplayReport report = ReplayReport();
+	TraceHeader header;
+	if (!readTraceHeader(data, length, header))
+		return report;
+	if (!wordSize)
+		wordSize = header.wordSize;
+	if (!sizeInWords)
+		sizeInWords = header.sizeInWords;
+	report.wordSize = wordSize;
+	report.sizeInWords = sizeInWords;
+
+	MemoryManager memoryManager(wordSize, allocator);
+	memoryManager.initialize(sizeInWords);
+	uint8_t* memStart = (uint8_t*)memoryManager.getMemoryStart();
+	if (!memStart)
+		return report;
+
+	//recorded block offset -> block returned by this replay
+	unordered_map<int32_t, pair<void*, size_t>> liveBlocks;
+	//large objects never touch the arena: they only count towards bytes in use and footprint, by recorded id
+	unordered_map<int32_t, size_t> liveLarge;
+	size_t bytesInUse = 0, largeBytes = 0, arenaEnd = 0;
+	chrono::steady_clock::duration samplingTime = chrono::steady_clock::duration::zero();
+
+	size_t count = getTraceRecordCount(length);
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++)
+	{
+		TraceRecord record = readTraceRecord(data, i);
+		if (record.op == TRACE_ALLOCATE)
+		{
+			report.allocations++;
+			//without useHints every allocation is replayed as a plain one, to compare placement with and without hints
+			void* p = useHints ? memoryManager.allocate(record.sizeBytes, (Lifetime)record.hint) : memoryManager.allocate(record.sizeBytes);
+			if (!p)
+				report.failures++;
+			else
+			{
+				if (record.offsetBytes >= 0)
+					liveBlocks[record.offsetBytes] = make_pair(p, (size_t)record.sizeBytes);
+				bytesInUse += record.sizeBytes;
+				arenaEnd = max(arenaEnd, (size_t)((uint8_t*)p - memStart) + record.sizeBytes);
+				report.peakBytesInUse = max(report.peakBytesInUse, bytesInUse);
+				report.peakFootprintBytes = max(report.peakFootprintBytes, arenaEnd + largeBytes);
+			}
+		}
+		else if (record.op == TRACE_ALLOCATE_LARGE)
+		{
+			report.allocations++;
+			if (record.offsetBytes < 0)
+				report.failures++;
+			else
+			{
+				liveLarge[record.offsetBytes] = record.sizeBytes;
+				bytesInUse += record.sizeBytes;
+				largeBytes += record.sizeBytes;
+				report.peakBytesInUse = max(report.peakBytesInUse, bytesInUse);
+				report.peakFootprintBytes = max(report.peakFootprintBytes, arenaEnd + largeBytes);
+			}
+		}
+		else if (record.op == TRACE_FREE_LARGE)
+		{
+			report.frees++;
+			unordered_map<int32_t, size_t>::iterator object = liveLarge.find(record.offsetBytes);
+			if (object != liveLarge.end())
+			{
+				bytesInUse -= object->second;
+				largeBytes -= object->second;
+				liveLarge.erase(object);
+			}
+		}
+		else if (record.op == TRACE_FREE)
+		{
+			report.frees++;
+			//blocks that failed to allocate in this replay have nothing to free
+			unordered_map<int32_t, pair<void*, size_t>>::iterator block = liveBlocks.find(record.offsetBytes);
+			if (block != liveBlocks.end())
+			{
+				memoryManager.free(block->second.first);
+				bytesInUse -= block->second.second;
+				liveBlocks.erase(block);
+			}
+		}
+		report.operations++;
+
+		if (sampleInterval && report.operations % sampleInterval == 0)
+		{
+			chrono::steady_clock::time_point sampleStart = chrono::steady_clock::now();
+			report.fragmentation.push_back(sampleFragmentation(memoryManager, report.operations));
+			samplingTime += chrono::steady_clock::now() - sampleStart;
+		}
+	}
+
+	//throughput only counts allocate/free, not the fragmentation sampling
+	report.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin - samplingTime).count();
+	if (report.seconds > 0)
+		report.opsPerSecond = report.operations / report.seconds;
+
+	memoryManager.shutdown();
+	return report;
+}
+void printReplayReport(const ReplayReport& report)
+{
+	cout << "operations: " << report.operations << " (" << report.allocations << " allocate, " << report.frees << " free)" << endl;
+	cout << "failed allocations: " << report.failures << endl;
+	cout << "throughput: " << (size_t)report.opsPerSecond << " ops/s" << endl;
+	cout << "peak bytes in use: " << report.peakBytesInUse << endl;
+	cout << "peak footprint: " << report.peakFootprintBytes << " bytes" << endl;
+	if (report.fragmentation.empty())
+		return;
+	cout << "fragmentation over time:" << endl;
+	for (size_t i = 0; i < report.fragmentation.size(); i++)
+	{
+		const FragmentationSample& sample = report.fragmentation[i];
+		cout << "  op " << sample.operation << ": " << sample.fragmentation << " (free " << sample.freeBytes << ", largest hole " << sample.largestHoleBytes << ")" << endl;
+	}
+}
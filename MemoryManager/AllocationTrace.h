@@ -0,0 +1,102 @@
+/*
+	Allocation traces: a recorder that logs every allocate/free call a MemoryManager handles, and a replay
+	driver that feeds a recorded trace into a fresh MemoryManager so allocators can be compared against real workloads.
+
+	Trace file layout (all fields little-endian):
+		header:  "MMTR" | uint32 version | uint32 wordSize | uint32 sizeInWords
+		records: uint64 timestampNs | uint32 sizeBytes | int32 offsetBytes | uint8 op | uint8 lifetime hint | 2 reserved bytes
+	offsetBytes is the byte offset returned by allocate (-1 if it failed) or the offset of the freed block.
+	The hint byte is 0 (LIFETIME_SHORT) for frees and plain allocate calls, so older traces read the same.
+	Large objects (see MemoryManagerBase::setLargeObjectThreshold) live outside the arena and have their own ops;
+	their offsetBytes is an id numbering them in allocation order, matching each free to its allocate.
+*/
+
+#include "MemoryManager.h"
+#include <stdint.h>
+#include <chrono>
+#pragma once
+
+#define TRACE_MAGIC "MMTR"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_BYTES 16
+#define TRACE_RECORD_BYTES 20
+
+enum TraceOp : uint8_t
+{
+	TRACE_ALLOCATE = 1,
+	TRACE_FREE = 2,
+	TRACE_ALLOCATE_LARGE = 3,
+	TRACE_FREE_LARGE = 4
+};
+
+struct TraceHeader
+{
+	uint32_t version;
+	uint32_t wordSize;
+	uint32_t sizeInWords;
+};
+
+struct TraceRecord
+{
+	uint64_t timestampNs;
+	uint32_t sizeBytes;
+	int32_t offsetBytes;
+	uint8_t op;
+	uint8_t hint;
+};
+
+class TraceRecorder
+{
+public:
+	TraceRecorder();
+	~TraceRecorder();
+	int open(char* filename, unsigned wordSize, unsigned sizeInWords);
+	void recordAllocate(size_t sizeBytes, int offsetBytes, Lifetime hint = LIFETIME_SHORT);
+	void recordFree(size_t sizeBytes, int offsetBytes);
+	void recordAllocateLarge(size_t sizeBytes, void* address, Lifetime hint = LIFETIME_SHORT);
+	void recordFreeLarge(size_t sizeBytes, void* address);
+	int close();
+private:
+	void record(uint8_t op, size_t sizeBytes, int offsetBytes, uint8_t hint);
+	int flush();
+	int fd;
+	chrono::steady_clock::time_point start;
+	vector<uint8_t> buffer;
+	map<void*, int32_t> largeIds; //live large object -> id it was recorded under
+	int32_t nextLargeId;
+};
+
+//Fragmentation at one point of a replay: 1 - (largest hole / total free bytes), 0 when all free space is one hole
+struct FragmentationSample
+{
+	size_t operation;
+	size_t freeBytes;
+	size_t largestHoleBytes;
+	double fragmentation;
+};
+
+struct ReplayReport
+{
+	unsigned wordSize; //arena the trace was replayed into (the trace header's values when 0 was asked for)
+	size_t sizeInWords;
+	size_t operations;
+	size_t allocations;
+	size_t frees;
+	size_t failures;
+	double seconds;
+	double opsPerSecond;
+	size_t peakBytesInUse;
+	size_t peakFootprintBytes; //highest byte offset ever occupied, plus the large objects mapped at the time
+	vector<FragmentationSample> fragmentation;
+};
+
+//Trace parsing (data/length is the whole trace file, e.g. loaded with loadTrace)
+int loadTrace(char* filename, vector<uint8_t>& data);
+bool readTraceHeader(const uint8_t* data, size_t length, TraceHeader& header);
+size_t getTraceRecordCount(size_t length);
+TraceRecord readTraceRecord(const uint8_t* data, size_t index);
+
+//Replays a trace into a fresh MemoryManager. wordSize/sizeInWords of 0 use the values stored in the trace header.
+//A fragmentation sample is taken every sampleInterval operations (0 disables sampling).
+ReplayReport replayTrace(const uint8_t* data, size_t length, unsigned wordSize, size_t sizeInWords, std::function<int(int, void*)> allocator, size_t sampleInterval, bool useHints = false);
+void printReplayReport(const ReplayReport& report);
@@ -1,4 +1,12 @@
 #include "MemoryManager/MemoryManager.h"
+#include "MemoryManager/AllocationTrace.h"
+#include "MemoryManager/Simulation.h"
+#include "MemoryManager/MemoryResource.h"
+#include "MemoryManager/ObjectPool.h"
+#include "MemoryManager/Region.h"
+#include "MemoryManager/GrowableMemoryManager.h"
+#include "MemoryManager/ShardedMemoryManager.h"
+#include "MemoryManager/MemoryMapWriter.h"
 #include <string>
 #include <cmath>
 #include <array>
@@ -6,6 +14,7 @@
 #include <fstream>
 #include <vector>
 #include <iostream>
+#include <thread>
 
 
 
@@ -20,12 +29,47 @@ unsigned int testRepeatedShutdown();
 unsigned int testMaxInitialization();
 unsigned int testGetters();
 unsigned int testReadingUsingGetMemoryStart();
+unsigned int testTraceReplay();
+unsigned int testParallelSimulation();
+unsigned int testMetadataOnly();
+unsigned int testNextFit();
+unsigned int testFirstFit();
+unsigned int testPolicyManagers();
+unsigned int testMemoryResource();
+unsigned int testObjectPool();
+unsigned int testRegion();
+unsigned int testLifetimeHints();
+unsigned int testGrowableHeap();
+unsigned int testLargeObjects();
+unsigned int testShardedManager();
+unsigned int testBlockLookup();
+unsigned int testGetListBuffer();
+unsigned int testBestFitKernel();
+unsigned int testSegmentCoalescing();
+unsigned int testMoveAndReset();
+unsigned int testPrefault();
+unsigned int testMaintenanceWorker();
+unsigned int testDeferredFree();
+unsigned int testSnapshots();
+unsigned int testAsyncDump();
+unsigned int testRunLengthMap();
+unsigned int testHeapProfiler();
+unsigned int testArenaLimits();
+unsigned int testResourceLimits();
+unsigned int testPolicyLifetimeHints();
+unsigned int testLargeObjectTrace();
+unsigned int testShardAssignmentPerManager();
+unsigned int testZeroByteAllocate();
+unsigned int testTraceWhileMaintaining();
+unsigned int testProfilingWhileMaintaining();
+unsigned int testLifetimeNextFit();
+unsigned int testReadersWhileMaintaining();
 
 
 // helper functions
 std::string vectorToString(const std::vector<uint16_t>& vector);
 unsigned int testGetBitmap(MemoryManager& memoryManager, uint16_t correctBitmapLength, std::vector<uint8_t> correctBitmap);
-unsigned int testGetList(MemoryManager& memoryManager, uint16_t correctListLength, std::vector<uint16_t> correctList);
+template<class Manager> unsigned int testGetList(Manager& memoryManager, uint16_t correctListLength, std::vector<uint16_t> correctList);
 unsigned int testGetWordSize(MemoryManager& memoryManager, size_t correctWordSize);
 unsigned int testGetMemoryLimit(MemoryManager& memoryManager, size_t correctMemoryLimit);
 unsigned int testDumpMemoryMap(MemoryManager& memoryManager, std::string fileName, std::string correctFileContents);
@@ -78,7 +122,7 @@ int hopesAndDreamsAllocator(int sizeInWords, void* list)
 
 int main()
 {
-    unsigned int maxScore = 38;
+    unsigned int maxScore = 81;
     unsigned int score = 0;
 
     score += testMemoryLeaksNoShutdown(); // 0
@@ -108,7 +152,111 @@ int main()
     std::cout << "Score: " << score << " / " << maxScore << std::endl;
 
     score += 5 * testReadingUsingGetMemoryStart(); // 1 * 5
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testTraceReplay(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testParallelSimulation(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testMetadataOnly(); // 2
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testNextFit(); // 2
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testFirstFit(); // 2
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testPolicyManagers(); // 5
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testMemoryResource(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testObjectPool(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testRegion(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testLifetimeHints(); // 2
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testGrowableHeap(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testLargeObjects(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testShardedManager(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testBlockLookup(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testGetListBuffer(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testBestFitKernel(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testSegmentCoalescing(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testMoveAndReset(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testPrefault(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
 
+    score += testMaintenanceWorker(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testDeferredFree(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testSnapshots(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testAsyncDump(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testRunLengthMap(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testHeapProfiler(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testArenaLimits(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testResourceLimits(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testPolicyLifetimeHints(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testLargeObjectTrace(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testShardAssignmentPerManager(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testZeroByteAllocate(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testTraceWhileMaintaining(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testProfilingWhileMaintaining(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testLifetimeNextFit(); // 1
+    std::cout << "Score: " << score << " / " << maxScore << std::endl;
+
+    score += testReadersWhileMaintaining(); // 1
     std::cout << "Score: " << score << " / " << maxScore << std::endl;
 }
 
@@ -605,6 +753,379 @@ unsigned int testReadingUsingGetMemoryStart()
 }
 
 
+unsigned int testTraceReplay()
+{
+    std::cout << "Test Case: recording and replaying an allocation trace" << std::endl;
+    unsigned int wordSize = 8;
+    size_t numberOfWords = 26;
+    MemoryManager memoryManager(wordSize, bestFit);
+    memoryManager.initialize(numberOfWords);
+    memoryManager.startTrace((char*)"testTraceReplay.trace");
+
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 10));
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+    uint64_t* testArray3 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 2));
+    memoryManager.allocate(sizeof(uint64_t) * 6);
+    memoryManager.free(testArray1);
+    memoryManager.free(testArray3);
+    memoryManager.allocate(sizeof(uint64_t) * 30);
+
+    memoryManager.stopTrace();
+    memoryManager.shutdown();
+
+    std::vector<uint8_t> trace;
+    if (loadTrace((char*)"testTraceReplay.trace", trace) == -1) {
+        std::cout << "[INCORRECT]\n" << std::endl;
+        return 0;
+    }
+
+    // holes after replay: [0, 10] - [12, 2] - [20, 6]
+    ReplayReport report = replayTrace(trace.data(), trace.size(), 0, 0, bestFit, 1);
+    printReplayReport(report);
+
+    double correctFragmentation = 1.0 - 10.0 / 18.0;
+    if (report.operations == 7 && report.failures == 1 && report.peakBytesInUse == 160 && report.peakFootprintBytes == 160
+        && report.fragmentation.size() == 7 && std::abs(report.fragmentation.back().fragmentation - correctFragmentation) < 1e-9) {
+        std::cout << "[CORRECT]\n" << std::endl;
+        return 1;
+    }
+    else {
+        std::cout << "[INCORRECT]\n" << std::endl;
+        return 0;
+    }
+}
+
+
+unsigned int testParallelSimulation()
+{
+    std::cout << "Test Case: parallel multi-strategy simulation" << std::endl;
+
+    // records the same workload as testTraceReplay into its own trace file
+    MemoryManager memoryManager(8, bestFit);
+    memoryManager.initialize(26);
+    memoryManager.startTrace((char*)"testParallelSimulation.trace");
+    void* block1 = memoryManager.allocate(sizeof(uint64_t) * 10);
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+    void* block3 = memoryManager.allocate(sizeof(uint64_t) * 2);
+    memoryManager.allocate(sizeof(uint64_t) * 6);
+    memoryManager.free(block1);
+    memoryManager.free(block3);
+    memoryManager.allocate(sizeof(uint64_t) * 30);
+    memoryManager.stopTrace();
+    memoryManager.shutdown();
+
+    std::vector<SimulationConfig> configs = makeSweep({ { "bestFit", bestFit }, { "worstFit", worstFit } }, { 8, 16 }, { 0, 64 });
+    std::vector<SimulationResult> results;
+    int simulated = runSimulations((char*)"testParallelSimulation.trace", configs, 0, 0, results);
+    unlink("testParallelSimulation.trace");
+    if (simulated == -1) {
+        std::cout << "[INCORRECT]\n" << std::endl;
+        return 0;
+    }
+    printSimulationTable(results);
+
+    // the 30 word allocation only fits once the heap has 64 words of 8 bytes or words of 16 bytes
+    for (size_t i = 0; i < results.size(); ++i) {
+        size_t correctFailures = (results[i].config.wordSize == 8 && results[i].config.sizeInWords == 0) ? 1 : 0;
+        // sizes of 0 come from the trace header, the report has the ones actually used
+        size_t correctWords = results[i].config.sizeInWords == 0 ? 26 : results[i].config.sizeInWords;
+        if (results[i].config.strategy != configs[i].strategy || results[i].report.operations != 7 || results[i].report.failures != correctFailures
+            || results[i].report.wordSize != results[i].config.wordSize || results[i].report.sizeInWords != correctWords) {
+            std::cout << "[INCORRECT]\n" << std::endl;
+            return 0;
+        }
+    }
+    std::cout << "[CORRECT]\n" << std::endl;
+    return 1;
+}
+
+
+unsigned int testMetadataOnly()
+{
+    // same allocations as testSimpleFirstFit, without any backing memory
+    std::cout << "Test Case: metadata-only mode" << std::endl;
+    unsigned int wordSize = 8;
+    size_t numberOfWords = 26;
+    MemoryManager memoryManager(wordSize, bestFit);
+    memoryManager.setMetadataOnly(true);
+    memoryManager.initialize(numberOfWords);
+
+    void* handle1 = memoryManager.allocate(sizeof(uint64_t) * 10);
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+    void* handle3 = memoryManager.allocate(sizeof(uint64_t) * 2);
+    memoryManager.allocate(sizeof(uint64_t) * 6);
+
+    memoryManager.free(handle1);
+    memoryManager.free(handle3);
+
+    std::vector<uint8_t> correctBitmap{ 0x00,0xCC,0x0F,0x00 };
+    std::vector<uint16_t> correctList = { 0, 10, 12, 2, 20, 6 };
+    uint16_t correctListLength = correctList.size() * 2;
+
+    unsigned int score = 0;
+    score += testGetBitmap(memoryManager, correctBitmap.size(), correctBitmap);
+    score += testGetList(memoryManager, correctListLength, correctList);
+
+    memoryManager.shutdown();
+
+    return score;
+}
+
+
+unsigned int testNextFit()
+{
+    std::cout << "Test Case: Next Fit" << std::endl;
+    unsigned int wordSize = 8;
+    size_t numberOfWords = 20;
+    MemoryManager memoryManager(wordSize, NextFit());
+    memoryManager.initialize(numberOfWords);
+
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 4));
+    memoryManager.allocate(sizeof(uint64_t) * 4);
+    uint64_t* testArray3 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 4));
+    memoryManager.allocate(sizeof(uint64_t) * 4);
+
+    memoryManager.free(testArray1);
+    memoryManager.free(testArray3);
+
+    // the search resumes at the tail hole instead of the lower holes
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+
+    std::vector<uint16_t> correctListAfter1 = { 0, 4, 8, 4 };
+    uint16_t correctListLengthAfter1 = correctListAfter1.size() * 2;
+
+    unsigned int score = 0;
+    score += testGetList(memoryManager, correctListLengthAfter1, correctListAfter1);
+
+    // nothing left past the cursor, wraps around to the start
+    memoryManager.allocate(sizeof(uint64_t) * 3);
+    memoryManager.allocate(sizeof(uint64_t) * 1);
+
+    std::vector<uint16_t> correctListAfter2 = { 8, 4 };
+    uint16_t correctListLengthAfter2 = correctListAfter2.size() * 2;
+
+    score += testGetList(memoryManager, correctListLengthAfter2, correctListAfter2);
+
+    memoryManager.shutdown();
+
+    return score;
+}
+
+
+unsigned int testFirstFit()
+{
+    std::cout << "Test Case: First Fit (hole index and callback)" << std::endl;
+    unsigned int wordSize = 8;
+    size_t numberOfWords = 20;
+
+    // firstFit itself is served from the hole index, the wrapped one goes through getList
+    std::vector<std::function<int(int, void*)>> allocators = { firstFit, [](int sizeInWords, void* list) { return firstFit(sizeInWords, list); } };
+
+    unsigned int score = 0;
+    for (auto allocator : allocators) {
+        MemoryManager memoryManager(wordSize, allocator);
+        memoryManager.initialize(numberOfWords);
+
+        uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 6));
+        memoryManager.allocate(sizeof(uint64_t) * 2);
+        uint64_t* testArray3 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 3));
+        memoryManager.allocate(sizeof(uint64_t) * 2);
+
+        memoryManager.free(testArray1);
+        memoryManager.free(testArray3);
+
+        // lowest hole that fits, not the smallest or largest one
+        memoryManager.allocate(sizeof(uint64_t) * 3);
+        memoryManager.allocate(sizeof(uint64_t) * 5);
+
+        std::vector<uint16_t> correctList = { 3, 3, 8, 3, 18, 2 };
+        uint16_t correctListLength = correctList.size() * 2;
+
+        score += testGetList(memoryManager, correctListLength, correctList);
+
+        memoryManager.shutdown();
+    }
+
+    return score;
+}
+
+
+template<class Manager>
+unsigned int testPolicyScenario(Manager& memoryManager, std::vector<uint16_t> correctList)
+{
+    // same allocations as testFirstFit: holes [0, 6] - [8, 3] - [13, 7] before the last two allocations
+    memoryManager.initialize(20);
+
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 6));
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+    uint64_t* testArray3 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 3));
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+
+    memoryManager.free(testArray1);
+    memoryManager.free(testArray3);
+
+    memoryManager.allocate(sizeof(uint64_t) * 3);
+    memoryManager.allocate(sizeof(uint64_t) * 5);
+
+    unsigned int score = testGetList(memoryManager, correctList.size() * 2, correctList);
+    memoryManager.shutdown();
+    return score;
+}
+
+
+unsigned int testPolicyManagers()
+{
+    std::cout << "Test Case: compile-time policy managers" << std::endl;
+    unsigned int score = 0;
+
+    BasicMemoryManager<FirstFitPolicy, 8> firstFitManager;
+    score += testPolicyScenario(firstFitManager, { 3, 3, 8, 3, 18, 2 });
+
+    BasicMemoryManager<BestFitPolicy, 8> bestFitManager;
+    score += testPolicyScenario(bestFitManager, { 5, 1, 13, 7 });
+
+    BasicMemoryManager<WorstFitPolicy, 8> worstFitManager;
+    score += testPolicyScenario(worstFitManager, { 5, 1, 8, 3, 16, 4 });
+
+    BasicMemoryManager<NextFitPolicy, 8> nextFitManager;
+    score += testPolicyScenario(nextFitManager, { 5, 1, 8, 3, 16, 4 });
+
+    // runtime word size, same answers as bestFit through the callback
+    BasicMemoryManager<BestFitPolicy, DYNAMIC_WORD_SIZE> dynamicManager(8, BestFitPolicy());
+    score += testPolicyScenario(dynamicManager, { 5, 1, 13, 7 });
+
+    return score;
+}
+
+
+unsigned int testMemoryResource()
+{
+    std::cout << "Test Case: pmr memory resource and STL allocator" << std::endl;
+    unsigned int wordSize = 8;
+    size_t numberOfWords = 1000;
+    MemoryManager memoryManager(wordSize, firstFit);
+    memoryManager.initialize(numberOfWords);
+    uint8_t* arenaStart = static_cast<uint8_t*>(memoryManager.getMemoryStart());
+    uint8_t* arenaEnd = arenaStart + memoryManager.getMemoryLimit();
+
+    MemoryManagerResource<MemoryManager> resource(memoryManager);
+    bool correct = true;
+    {
+        std::pmr::vector<uint64_t> values(&resource);
+        std::vector<uint32_t, ManagerAllocator<uint32_t>> typedValues{ ManagerAllocator<uint32_t>(memoryManager) };
+        for (uint64_t i = 0; i < 100; ++i) {
+            values.push_back(i);
+            typedValues.push_back(i);
+        }
+        uint8_t* data = reinterpret_cast<uint8_t*>(values.data());
+        uint8_t* typedData = reinterpret_cast<uint8_t*>(typedValues.data());
+        correct = correct && data >= arenaStart && data < arenaEnd && typedData >= arenaStart && typedData < arenaEnd;
+
+        // stricter than word alignment
+        void* aligned = resource.allocate(100, 64);
+        correct = correct && reinterpret_cast<uintptr_t>(aligned) % 64 == 0;
+        resource.deallocate(aligned, 100, 64);
+    }
+
+    // everything was handed back: a single hole covering the arena again
+    uint16_t* list = static_cast<uint16_t*>(memoryManager.getList());
+    correct = correct && list[0] == 1 && list[1] == 0 && list[2] == numberOfWords;
+    delete[] list;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+
+unsigned int testObjectPool()
+{
+    std::cout << "Test Case: object pool" << std::endl;
+    struct Node
+    {
+        Node(uint64_t key, Node* next) : key(key), next(next) {}
+        uint64_t key;
+        Node* next;
+    };
+
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.initialize(4000);
+    bool correct = true;
+    {
+        ObjectPool<Node> pool(memoryManager, 16);
+        Node* head = nullptr;
+        for (uint64_t i = 0; i < 100; ++i)
+            head = pool.create(i, head);
+        correct = correct && pool.getLiveCount() == 100 && pool.getChunkCount() == 7;
+
+        // destroy every other node, then refill: freed slots are reused before new chunks
+        std::vector<Node*> nodes;
+        for (Node* node = head; node; node = node->next)
+            nodes.push_back(node);
+        for (size_t i = 0; i < nodes.size(); i += 2)
+            pool.destroy(nodes[i]);
+        for (size_t i = 0; i < nodes.size(); i += 2)
+            nodes[i] = pool.create(i, nullptr);
+        correct = correct && pool.getChunkCount() == 7;
+        for (size_t i = 1; i < nodes.size(); i += 2)
+            correct = correct && nodes[i]->key == 99 - i;
+
+        // empty chunks go back to the manager, one spare stays
+        for (size_t i = 0; i < nodes.size(); ++i)
+            pool.destroy(nodes[i]);
+        correct = correct && pool.getLiveCount() == 0 && pool.getChunkCount() == 1;
+    }
+
+    // the pool gave its last chunk back when it was destroyed
+    uint16_t* list = static_cast<uint16_t*>(memoryManager.getList());
+    correct = correct && list[0] == 1 && list[2] == 4000;
+    delete[] list;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+
+unsigned int testRegion()
+{
+    std::cout << "Test Case: bump region with mark and reset" << std::endl;
+    MemoryManager memoryManager(8, bestFit);
+    memoryManager.initialize(100);
+    bool correct = true;
+    {
+        Region<> region(memoryManager, 256);
+        correct = correct && region.getCapacity() == 256;
+
+        uint64_t* first = static_cast<uint64_t*>(region.allocate(sizeof(uint64_t) * 4));
+        size_t requestMark = region.mark();
+        char* scratch1 = static_cast<char*>(region.allocate(3, 1));
+        uint64_t* scratch2 = static_cast<uint64_t*>(region.allocate(sizeof(uint64_t) * 2));
+        correct = correct && reinterpret_cast<uintptr_t>(scratch2) % alignof(uint64_t) == 0 && region.getUsed() == 64;
+
+        // rolling back hands out the same memory again
+        region.resetTo(requestMark);
+        correct = correct && region.allocate(3, 1) == scratch1;
+
+        // too big for what's left
+        correct = correct && region.allocate(250) == nullptr;
+        // sizes near the top of size_t must not wrap past the capacity check
+        correct = correct && region.allocate(SIZE_MAX) == nullptr && region.allocate(SIZE_MAX - 8, 1) == nullptr && region.getUsed() == 32 + 3;
+
+        region.releaseAll();
+        correct = correct && region.getUsed() == 0 && region.allocate(sizeof(uint64_t) * 4) == first;
+
+        // the region is one block in the manager
+        std::vector<uint16_t> correctList = { 32, 68 };
+        correct = testGetList(memoryManager, correctList.size() * 2, correctList) && correct;
+    }
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+
 std::string vectorToString(const std::vector<uint16_t>& vector)
 {
     std::string vectorString = "";
@@ -663,7 +1184,7 @@ unsigned int testGetBitmap(MemoryManager& memoryManager, uint16_t correctBitmapL
 }
 
 
-unsigned int testGetList(MemoryManager& memoryManager, uint16_t correctListLength, std::vector<uint16_t> correctList)
+template<class Manager> unsigned int testGetList(Manager& memoryManager, uint16_t correctListLength, std::vector<uint16_t> correctList)
 {
     unsigned int score = 0;
     std::cout << std::dec << std::endl;
@@ -759,4 +1280,1029 @@ unsigned int testDumpMemoryMap(MemoryManager& memoryManager, std::string fileNam
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+template<class Manager>
+unsigned int testLifetimeScenario(Manager& memoryManager, std::vector<uint16_t> correctList)
+{
+    memoryManager.initialize(20);
+
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 3));
+    uint64_t* testArray2 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 4, LIFETIME_LONG));
+    memoryManager.allocate(sizeof(uint64_t) * 2);
+    memoryManager.free(testArray1);
+
+    // long-lived blocks take the top end of the hole the policy picks, permanent ones the highest hole
+    memoryManager.allocate(sizeof(uint64_t) * 2, LIFETIME_LONG);
+    memoryManager.allocate(sizeof(uint64_t) * 1, LIFETIME_PERMANENT);
+
+    bool correct = testArray2 == static_cast<uint64_t*>(memoryManager.getMemoryStart()) + 16;
+    unsigned int score = testGetList(memoryManager, correctList.size() * 2, correctList) && correct ? 1 : 0;
+    memoryManager.shutdown();
+    return score;
+}
+unsigned int testLifetimeHints()
+{
+    std::cout << "Test Case: Lifetime hints (callback and policy)" << std::endl;
+    unsigned int score = 0;
+
+    // bestFit sees the hole list from the top, so the smallest hole that fits is still chosen
+    MemoryManager callbackManager(8, bestFit);
+    score += testLifetimeScenario(callbackManager, { 0, 1, 5, 10 });
+
+    BasicMemoryManager<FirstFitPolicy, 8> policyManager;
+    score += testLifetimeScenario(policyManager, { 0, 3, 5, 8 });
+
+    return score;
+}
+unsigned int testGrowableHeap()
+{
+    std::cout << "Test Case: Growable heap adds and releases chunks" << std::endl;
+    GrowableMemoryManager memoryManager(8, firstFit);
+    bool correct = memoryManager.initialize(16) == 0;
+
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 12));
+    // doesn't fit in what's left of the first chunk: a second chunk of twice the size
+    uint64_t* testArray2 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 10));
+    correct = correct && testArray1 && testArray2 && memoryManager.getChunkCount() == 2 && memoryManager.getMemoryLimit() == 8 * (16 + 32);
+
+    // bigger than the doubled size: the chunk grows to fit the request
+    uint64_t* testArray3 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 40));
+    uint64_t* testArray4 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 20));
+    correct = correct && testArray3 && testArray4 && memoryManager.getChunkCount() == 3 && memoryManager.getMemoryLimit() == 8 * (16 + 32 + 64);
+    for (int i = 0; i < 40; i++)
+        testArray3[i] = i;
+    correct = correct && testArray3[39] == 39;
+
+    // emptying a chunk hands it back, the first chunk is kept
+    memoryManager.free(testArray3);
+    memoryManager.free(testArray4);
+    correct = correct && memoryManager.getChunkCount() == 2;
+    memoryManager.free(testArray1);
+    memoryManager.free(testArray2);
+    correct = correct && memoryManager.getChunkCount() == 1 && memoryManager.getMemoryLimit() == 8 * 16;
+
+    // over the per-chunk limit
+    correct = correct && memoryManager.allocate(8 * 70000) == nullptr;
+
+    // a first chunk that can't be set up fails initialize, leaving nothing to allocate from
+    correct = correct && memoryManager.initialize(MAX_CHUNK_WORDS + 1) == -1 && memoryManager.getChunkCount() == 0 && memoryManager.allocate(8) == nullptr;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+unsigned int testLargeObjects()
+{
+    std::cout << "Test Case: Large objects bypass the arena" << std::endl;
+    MemoryManager memoryManager(8, bestFit);
+    memoryManager.initialize(64);
+    memoryManager.setLargeObjectThreshold(128);
+    bool correct = true;
+
+    // bigger than the whole arena, still fine: it gets its own mapping
+    uint8_t* large = static_cast<uint8_t*>(memoryManager.allocate(4096));
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 2));
+    correct = correct && large && testArray1 && memoryManager.getLargeObjectCount() == 1;
+    for (int i = 0; i < 4096; i++)
+        large[i] = (uint8_t)i;
+    correct = correct && large[4095] == (uint8_t)4095;
+
+    // the arena only holds the small block
+    std::vector<uint16_t> correctList = { 2, 62 };
+    correct = testGetList(memoryManager, correctList.size() * 2, correctList) && correct;
+
+    memoryManager.free(large);
+    correct = correct && memoryManager.getLargeObjectCount() == 0;
+
+    // still left mapped at shutdown: unmapped with the arena
+    memoryManager.allocate(1024);
+    memoryManager.shutdown();
+    correct = correct && memoryManager.getLargeObjectCount() == 0;
+
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+unsigned int testShardedManager()
+{
+    std::cout << "Test Case: Sharded manager with cross-thread frees" << std::endl;
+    ShardedMemoryManager memoryManager(4, 8, firstFit, SHARD_BY_THREAD);
+    memoryManager.initialize(64);
+    bool correct = memoryManager.getShardCount() == 4 && memoryManager.getMemoryLimit() == 4 * 64 * 8;
+
+    // every thread allocates from its own shard
+    std::vector<std::vector<void*>> blocks(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.push_back(std::thread([&memoryManager, &blocks, t]() {
+            for (int i = 0; i < 8; i++)
+                blocks[t].push_back(memoryManager.allocate(sizeof(uint64_t) * 2));
+        }));
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    for (unsigned s = 0; s < 4; s++)
+        correct = correct && memoryManager.getShard(s).getHoleCount() == 1 && memoryManager.getShard(s).getHoleSizeBytes(0) == 48 * 8;
+
+    // freed from this thread, routed back to the shard that owns each block
+    for (int t = 0; t < 4; t++)
+        for (size_t i = 0; i < blocks[t].size(); i++) {
+            correct = correct && blocks[t][i] != nullptr;
+            memoryManager.free(blocks[t][i]);
+        }
+    for (unsigned s = 0; s < 4; s++)
+        correct = correct && memoryManager.getShard(s).getHoleSizeBytes(0) == 64 * 8;
+
+    // a full home shard falls back to the others
+    int whole = 0;
+    for (int i = 0; i < 5; i++)
+        whole += memoryManager.allocate(64 * 8) != nullptr;
+    correct = correct && whole == 4;
+
+    // large objects aren't in any arena, their free still reaches the shard that mapped them
+    for (unsigned s = 0; s < 4; s++)
+        memoryManager.getShard(s).setLargeObjectThreshold(128);
+    void* large = memoryManager.allocate(4096);
+    size_t mapped = 0;
+    for (unsigned s = 0; s < 4; s++)
+        mapped += memoryManager.getShard(s).getLargeObjectCount();
+    memoryManager.free(large);
+    for (unsigned s = 0; s < 4; s++)
+        mapped -= memoryManager.getShard(s).getLargeObjectCount();
+    correct = correct && large && mapped == 1;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+unsigned int testBlockLookup()
+{
+    std::cout << "Test Case: Interior pointer lookup and free" << std::endl;
+    MemoryManager memoryManager(8, bestFit);
+    memoryManager.initialize(32);
+    memoryManager.setLargeObjectThreshold(128);
+    bool correct = true;
+
+    uint8_t* testArray1 = static_cast<uint8_t*>(memoryManager.allocate(24));
+    uint8_t* testArray2 = static_cast<uint8_t*>(memoryManager.allocate(5));
+    uint8_t* large = static_cast<uint8_t*>(memoryManager.allocate(4096));
+
+    // any pointer into a block maps back to it, block sizes are whole words
+    BlockInfo block = memoryManager.findBlock(testArray1 + 23);
+    correct = correct && block.start == testArray1 && block.sizeBytes == 24;
+    block = memoryManager.findBlock(testArray2 + 7);
+    correct = correct && block.start == testArray2 && block.sizeBytes == 8;
+    block = memoryManager.findBlock(large + 100);
+    correct = correct && block.start == large && block.sizeBytes == 4096;
+    correct = correct && memoryManager.owns(testArray2) && !memoryManager.owns(testArray2 + 8) && !memoryManager.owns(&block);
+
+    // interior pointers are ignored until interior free is turned on
+    memoryManager.free(testArray1 + 10);
+    correct = correct && memoryManager.owns(testArray1);
+    memoryManager.setInteriorFree(true);
+    memoryManager.free(testArray1 + 10);
+    memoryManager.free(large + 5);
+    correct = correct && !memoryManager.owns(testArray1) && memoryManager.getLargeObjectCount() == 0;
+
+    std::vector<uint16_t> correctList = { 0, 3, 4, 28 };
+    correct = testGetList(memoryManager, correctList.size() * 2, correctList) && correct;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+unsigned int testGetListBuffer()
+{
+    std::cout << "Test Case: getList into a caller buffer" << std::endl;
+    MemoryManager memoryManager(8, worstFit);
+    memoryManager.initialize(40);
+    uint16_t buffer[16];
+    bool correct = memoryManager.getList(buffer, 16) == -1;
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 8; i++)
+        blocks.push_back(memoryManager.allocate(sizeof(uint64_t) * (i + 1)));
+    // holes are created out of address order, the list still comes out sorted
+    memoryManager.free(blocks[6]);
+    memoryManager.free(blocks[1]);
+    memoryManager.free(blocks[4]);
+    memoryManager.free(blocks[2]);
+
+    // too small: nothing written, the needed length comes back
+    buffer[0] = 99;
+    correct = correct && memoryManager.getList(buffer, 4) == 9 && buffer[0] == 99;
+    correct = correct && memoryManager.getList(buffer, 16) == 9;
+
+    std::vector<uint16_t> correctList = { 1, 5, 10, 5, 21, 7, 36, 4 };
+    correct = correct && buffer[0] == 4 && std::equal(correctList.begin(), correctList.end(), buffer + 1);
+    correct = testGetList(memoryManager, correctList.size() * 2, correctList) && correct;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+unsigned int testBestFitKernel()
+{
+    std::cout << "Test Case: Vectorized best fit (" << getHoleKernelName() << ") matches the list scan" << std::endl;
+    // bestFit is answered by the kernel, the wrapped one scans getList like any custom allocator
+    MemoryManager kernelManager(8, bestFit);
+    MemoryManager listManager(8, [](int sizeInWords, void* list) { return bestFit(sizeInWords, list); });
+    kernelManager.initialize(4096);
+    listManager.initialize(4096);
+    uint8_t* kernelStart = static_cast<uint8_t*>(kernelManager.getMemoryStart());
+    uint8_t* listStart = static_cast<uint8_t*>(listManager.getMemoryStart());
+
+    // random churn leaves a few hundred holes of mixed sizes, so the vector loops and their tails both run
+    std::vector<std::pair<uint8_t*, uint8_t*>> live;
+    unsigned seed = 2024;
+    bool correct = true;
+    for (int i = 0; i < 3000 && correct; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (live.size() > 20 && (seed >> 16) % 3 == 0) {
+            size_t victim = (seed >> 8) % live.size();
+            kernelManager.free(live[victim].first);
+            listManager.free(live[victim].second);
+            live.erase(live.begin() + victim);
+            continue;
+        }
+        size_t bytes = 8 * (1 + (seed >> 16) % 24);
+        uint8_t* a = static_cast<uint8_t*>(kernelManager.allocate(bytes));
+        uint8_t* b = static_cast<uint8_t*>(listManager.allocate(bytes));
+        correct = (a == nullptr) == (b == nullptr) && (!a || a - kernelStart == b - listStart);
+        if (a)
+            live.push_back(std::make_pair(a, b));
+    }
+    correct = correct && kernelManager.getHoleCount() > 32;
+
+    // every version this CPU can run, called directly on the same arrays as the scalar one: all lengths up to a few
+    // vectors (so tails shorter than a vector), few distinct sizes (so ties), unordered starts
+    BestFitKernel scalar = getBestFitKernel("scalar");
+    for (const char* name : { "avx2", "avx512" }) {
+        BestFitKernel kernel = getBestFitKernel(name);
+        if (!kernel)
+            continue;
+        std::cout << "checking " << name << " against scalar" << std::endl;
+        for (int count = 0; count <= 40 && correct; count++) {
+            std::vector<uint32_t> sizes(count), starts(count);
+            for (int i = 0; i < count; i++) {
+                seed = seed * 1103515245 + 12345;
+                sizes[i] = 8 * (1 + (seed >> 16) % 6);
+                starts[i] = 8 * ((i * 37 + 11) % 41) * 64;
+            }
+            for (uint32_t need = 0; need <= 56 && correct; need += 8)
+                correct = kernel(sizes.data(), starts.data(), count, need) == scalar(sizes.data(), starts.data(), count, need);
+        }
+    }
+    correct = correct && scalar && !getBestFitKernel("sse9");
+
+    kernelManager.shutdown();
+    listManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testSegmentCoalescing()
+{
+    std::cout << "Test Case: Split and coalesce churn matches a word-by-word model" << std::endl;
+    const int words = 512;
+    MemoryManager memoryManager(8, bestFit);
+    memoryManager.initialize(words);
+    uint8_t* start = static_cast<uint8_t*>(memoryManager.getMemoryStart());
+
+    // every hint is used so blocks get carved from the front, back and middle of holes
+    std::vector<bool> used(words, false);
+    std::vector<std::pair<uint8_t*, int>> live;
+    unsigned seed = 99;
+    bool correct = true;
+    for (int i = 0; i < 4000 && correct; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (!live.empty() && (seed >> 16) % 2 == 0) {
+            size_t victim = (seed >> 4) % live.size();
+            int offset = (live[victim].first - start) / 8;
+            for (int w = offset; w < offset + live[victim].second; w++)
+                used[w] = false;
+            memoryManager.free(live[victim].first);
+            live.erase(live.begin() + victim);
+        }
+        else {
+            int size = 1 + (seed >> 16) % 12;
+            uint8_t* p = static_cast<uint8_t*>(memoryManager.allocate(size * 8, (Lifetime)((seed >> 8) % 3)));
+            if (p) {
+                int offset = (p - start) / 8;
+                for (int w = offset; w < offset + size; w++) {
+                    correct = correct && !used[w];
+                    used[w] = true;
+                }
+                live.push_back(std::make_pair(p, size));
+            }
+        }
+
+        // holes must be exactly the maximal runs of free words
+        std::vector<uint16_t> expected(1, 0);
+        for (int w = 0; w < words; w++) {
+            if (!used[w] && (w == 0 || used[w - 1])) {
+                expected[0]++;
+                expected.push_back(w);
+                expected.push_back(0);
+            }
+            if (!used[w])
+                expected.back()++;
+        }
+        uint16_t buffer[2 * words + 1];
+        int length = memoryManager.getList(buffer, 2 * words + 1);
+        correct = correct && (length == -1 ? expected[0] == 1 && expected[2] == words : length == (int)expected.size());
+        correct = correct && (length == -1 || std::equal(expected.begin(), expected.end(), buffer));
+    }
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testMoveAndReset()
+{
+    std::cout << "Test Case: Move construction/assignment and reset()" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.initialize(64);
+    uint8_t* start = static_cast<uint8_t*>(memoryManager.getMemoryStart());
+    void* a = memoryManager.allocate(sizeof(uint64_t) * 10);
+    void* b = memoryManager.allocate(sizeof(uint64_t) * 6);
+    memoryManager.free(a);
+
+    // the arena moves with the manager, the source is left uninitialized
+    MemoryManager moved(std::move(memoryManager));
+    bool correct = memoryManager.getMemoryStart() == nullptr && memoryManager.allocate(8) == nullptr;
+    correct = correct && moved.getMemoryStart() == start && moved.owns(b);
+    uint16_t list[5];
+    correct = correct && moved.getList(list, 5) == 5 && list[1] == 0 && list[2] == 10 && list[3] == 16 && list[4] == 48;
+
+    // managers can live in containers
+    std::vector<MemoryManager> managers;
+    managers.push_back(std::move(moved));
+    managers.push_back(MemoryManager(8, bestFit));
+    managers[1].initialize(32);
+    correct = correct && managers[0].getMemoryStart() == start && managers[1].allocate(16) != nullptr;
+
+    // move assignment releases the target's old arena first
+    managers[1] = std::move(managers[0]);
+    correct = correct && managers[0].getMemoryStart() == nullptr && managers[1].getMemoryStart() == start;
+    managers[1].free(b);
+    correct = correct && managers[1].getHoleCount() == 1;
+
+    // reset keeps the arena: everything is one hole again and allocation starts over at the bottom
+    MemoryManager& manager = managers[1];
+    for (int i = 0; i < 6; i++)
+        manager.allocate(sizeof(uint64_t) * (i + 1));
+    manager.free(manager.allocate(8));
+    manager.reset();
+    correct = correct && manager.getMemoryStart() == start && manager.getHoleCount() == 1;
+    correct = correct && manager.getHoleSizeBytes(0) == 64 * 8 && manager.getList() == nullptr;
+    correct = correct && manager.allocate(64 * 8) == start;
+
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testPrefault()
+{
+    std::cout << "Test Case: Pre-faulted arenas are resident after initialize" << std::endl;
+    // 512KB arenas: one prefault thread uses MAP_POPULATE, four touch the pages in stripes
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    bool correct = true;
+    for (unsigned threads = 1; threads <= 4; threads += 3) {
+        MemoryManager memoryManager(64, firstFit);
+        memoryManager.initialize(8192, threads);
+        size_t pages = memoryManager.getMemoryLimit() / pageSize;
+        std::vector<unsigned char> resident(pages);
+        correct = correct && mincore(memoryManager.getMemoryStart(), memoryManager.getMemoryLimit(), resident.data()) == 0;
+        for (size_t page = 0; page < pages; page++)
+            correct = correct && (resident[page] & 1);
+        // and the arena works as usual
+        uint64_t* p = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 100));
+        correct = correct && p == memoryManager.getMemoryStart() && memoryManager.getHoleCount() == 1;
+        memoryManager.shutdown();
+    }
+
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testMaintenanceWorker()
+{
+    std::cout << "Test Case: Maintenance passes return free pages to the OS" << std::endl;
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    MemoryManager memoryManager(64, firstFit);
+    memoryManager.initialize(8192);
+    size_t pages = memoryManager.getMemoryLimit() / pageSize;
+    std::vector<unsigned char> resident(pages);
+    auto residentPages = [&]() {
+        mincore(memoryManager.getMemoryStart(), memoryManager.getMemoryLimit(), resident.data());
+        size_t count = 0;
+        for (size_t page = 0; page < pages; page++)
+            count += resident[page] & 1;
+        return count;
+    };
+
+    // a pass run by hand: the whole arena is one hole again after the free, so every page goes
+    memoryManager.free(memoryManager.allocate(memoryManager.getMemoryLimit()));
+    bool correct = residentPages() == pages;
+    correct = correct && memoryManager.maintain() == memoryManager.getMemoryLimit() && residentPages() == 0;
+    correct = correct && memoryManager.maintain() == 0;
+
+    // the worker starts with initialize() and trims while the foreground keeps allocating
+    memoryManager.setMaintenanceInterval(1);
+    memoryManager.initialize(8192);
+    correct = correct && memoryManager.getMaintenanceInterval() == 1;
+    uint8_t* keep = static_cast<uint8_t*>(memoryManager.allocate(pageSize));
+    memset(keep, 0x5A, pageSize);
+    for (int round = 0; round < 200 && correct; round++) {
+        uint64_t* p = static_cast<uint64_t*>(memoryManager.allocate(pageSize * 4));
+        for (size_t i = 0; i < pageSize / 2; i++)
+            p[i] = i + round;
+        for (size_t i = 0; i < pageSize / 2; i++)
+            correct = correct && p[i] == i + round;
+        memoryManager.free(p);
+    }
+    for (int wait = 0; wait < 1000 && residentPages() > 1; wait++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    correct = correct && residentPages() == 1 && keep[0] == 0x5A && keep[pageSize - 1] == 0x5A;
+
+    // shutdown stops the worker before the arena goes away
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testDeferredFree()
+{
+    std::cout << "Test Case: Deferred frees from other threads are reclaimed in batches" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.initialize(1024);
+    std::vector<void*> blocks;
+    for (int i = 0; i < 200; i++)
+        blocks.push_back(memoryManager.allocate(sizeof(uint64_t) * (1 + i % 4)));
+
+    // four producers queue every block; repeats and misaligned pointers are dropped
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++)
+        producers.push_back(std::thread([&blocks, &memoryManager, t]() {
+            for (size_t i = t; i < blocks.size(); i += 4)
+                memoryManager.freeDeferred(blocks[i]);
+            memoryManager.freeDeferred(blocks[t]);
+            memoryManager.freeDeferred(static_cast<uint8_t*>(blocks[t]) + 3);
+        }));
+    for (size_t t = 0; t < producers.size(); t++)
+        producers[t].join();
+
+    // nothing is freed until the owner drains, then it all coalesces back into one hole
+    bool correct = memoryManager.getDeferredCount() == 200 && memoryManager.getHoleCount() == 1;
+    correct = correct && memoryManager.drainDeferred() == 200 && memoryManager.getDeferredCount() == 0;
+    correct = correct && memoryManager.getHoleCount() == 1 && memoryManager.getHoleSizeBytes(0) == 1024 * 8;
+
+    // allocate drains once a batch is waiting...
+    for (int i = 0; i < 64; i++)
+        blocks[i] = memoryManager.allocate(sizeof(uint64_t));
+    for (int i = 0; i < 64; i++)
+        memoryManager.freeDeferred(blocks[i]);
+    void* p = memoryManager.allocate(sizeof(uint64_t));
+    correct = correct && memoryManager.getDeferredCount() == 0 && p == memoryManager.getMemoryStart();
+    memoryManager.free(p);
+
+    // ...or when nothing fits without the queued blocks
+    void* whole = memoryManager.allocate(1024 * 8);
+    std::thread([&memoryManager, whole]() { memoryManager.freeDeferred(whole); }).join();
+    correct = correct && memoryManager.allocate(512 * 8) == whole;
+
+    // large objects go through the same queue
+    memoryManager.setLargeObjectThreshold(1 << 16);
+    void* large = memoryManager.allocate(1 << 16);
+    std::thread([&memoryManager, large]() { memoryManager.freeDeferred(large); }).join();
+    correct = correct && memoryManager.getLargeObjectCount() == 1 && memoryManager.drainDeferred() == 1;
+    correct = correct && memoryManager.getLargeObjectCount() == 0;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testSnapshots()
+{
+    std::cout << "Test Case: Snapshots stay consistent while the owner allocates" << std::endl;
+    MemoryManager memoryManager(8, bestFit);
+    memoryManager.initialize(2048);
+    std::vector<void*> live;
+    unsigned seed = 7;
+    auto churn = [&]() {
+        seed = seed * 1103515245 + 12345;
+        if (live.size() > 40 && (seed >> 16) % 2 == 0) {
+            size_t victim = (seed >> 4) % live.size();
+            memoryManager.free(live[victim]);
+            live.erase(live.begin() + victim);
+        }
+        else if (void* p = memoryManager.allocate(8 * (1 + (seed >> 16) % 16)))
+            live.push_back(p);
+    };
+    for (int i = 0; i < 500; i++)
+        churn();
+
+    // a snapshot shows exactly what the manager shows
+    MemorySnapshot snapshot;
+    bool correct = memoryManager.takeSnapshot(snapshot);
+    uint16_t expected[2049], actual[2049];
+    int length = memoryManager.getList(expected, 2049);
+    correct = correct && snapshot.getList(actual, 2049) == length && std::equal(expected, expected + length, actual);
+    uint8_t* managerBitmap = static_cast<uint8_t*>(memoryManager.getBitmap());
+    uint8_t* snapshotBitmap = static_cast<uint8_t*>(snapshot.getBitmap());
+    correct = correct && memcmp(managerBitmap, snapshotBitmap, 2 + 2048 / 8) == 0;
+    delete[] managerBitmap;
+    delete[] snapshotBitmap;
+    memoryManager.dumpMemoryMap((char*)"testSnapshotManager.txt");
+    snapshot.dumpMemoryMap((char*)"testSnapshot.txt");
+    std::ifstream managerFile("testSnapshotManager.txt"), snapshotFile("testSnapshot.txt");
+    std::string managerMap, snapshotMap;
+    std::getline(managerFile, managerMap);
+    std::getline(snapshotFile, snapshotMap);
+    correct = correct && managerMap == snapshotMap && !managerMap.empty();
+
+    // a monitor thread never sees a half-made change: holes stay sorted, apart and inside the arena
+    std::atomic<bool> done(false);
+    std::atomic<int> snapshots(0);
+    std::atomic<bool> consistent(true);
+    std::thread monitor([&]() {
+        MemorySnapshot view;
+        uint64_t lastVersion = 0;
+        uint16_t list[2049];
+        while (!done) {
+            memoryManager.takeSnapshot(view);
+            int count = view.getList(list, 2049) / 2;
+            bool ok = view.getVersion() >= lastVersion && count == view.getHoleCount();
+            for (int j = 0; j < count; j++) {
+                ok = ok && list[2 * j + 2] > 0 && list[2 * j + 1] + list[2 * j + 2] <= 2048;
+                if (j > 0)
+                    ok = ok && list[2 * j - 1] + list[2 * j] < list[2 * j + 1];
+            }
+            lastVersion = view.getVersion();
+            if (!ok)
+                consistent = false;
+            snapshots++;
+        }
+    });
+    for (int i = 0; i < 20000 || snapshots < 10; i++)
+        churn();
+    done = true;
+    monitor.join();
+    correct = correct && consistent;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testAsyncDump()
+{
+    std::cout << "Test Case: Asynchronous memory map dumps" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    bool correct = memoryManager.dumpMemoryMapAsync((char*)"testAsyncDump.txt", nullptr) == -1;
+    memoryManager.initialize(64);
+    void* a = memoryManager.allocate(sizeof(uint64_t) * 10);
+    memoryManager.allocate(sizeof(uint64_t) * 10);
+    memoryManager.free(a);
+
+    // the dump shows the map as it was when queued, even though the manager changes right after
+    std::mutex lock;
+    std::condition_variable done;
+    int result = 1;
+    correct = correct && memoryManager.dumpMemoryMapAsync((char*)"testAsyncDump.txt", [&](int r) {
+        std::lock_guard<std::mutex> guard(lock);
+        result = r;
+        done.notify_all();
+    }) == 0;
+    memoryManager.allocate(sizeof(uint64_t) * 4);
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&]() { return result != 1; });
+    }
+    std::ifstream file("testAsyncDump.txt");
+    std::string map;
+    std::getline(file, map);
+    correct = correct && result == 0 && map == "[0, 10] - [20, 44]";
+
+    // the queue is bounded: with one writer stuck and one dump waiting, a third is refused
+    MemoryMapWriter writer(1, 2);
+    std::atomic<bool> release(false);
+    std::atomic<int> written(0);
+    auto slowCallback = [&](int r) {
+        while (!release)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        written += r == 0;
+    };
+    correct = correct && writer.submit(memoryManager, (char*)"testAsyncDump1.txt", slowCallback) == 0;
+    correct = correct && writer.submit(memoryManager, (char*)"testAsyncDump2.txt", slowCallback) == 0;
+    correct = correct && writer.submit(memoryManager, (char*)"testAsyncDump3.txt", slowCallback) == -1;
+    release = true;
+    writer.waitIdle();
+    correct = correct && written == 2 && writer.submit(memoryManager, (char*)"testAsyncDump3.txt", nullptr) == 0;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testRunLengthMap()
+{
+    std::cout << "Test Case: Run-length occupancy map round trips to the bitmap" << std::endl;
+    MemoryManager memoryManager(8, bestFit);
+    uint8_t encoded[4096];
+    bool correct = memoryManager.getRunLengthMap(encoded, sizeof(encoded)) == -1;
+    memoryManager.initialize(4000);
+
+    // fresh arena: 4000 words, 1 hole, runs [0 block, 4000 hole, 0 block]
+    correct = correct && memoryManager.getRunLengthMap(encoded, sizeof(encoded)) == 7;
+    correct = correct && encoded[0] == 0xA0 && encoded[1] == 0x1F && encoded[2] == 1 && encoded[3] == 0;
+
+    // after churn the decoded map matches getBitmap bit for bit, and the snapshot encodes the same bytes
+    std::vector<void*> live;
+    unsigned seed = 31;
+    for (int i = 0; i < 3000; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (live.size() > 30 && (seed >> 16) % 2 == 0) {
+            size_t victim = (seed >> 4) % live.size();
+            memoryManager.free(live[victim]);
+            live.erase(live.begin() + victim);
+        }
+        else if (void* p = memoryManager.allocate(8 * (1 + (seed >> 16) % 40)))
+            live.push_back(p);
+    }
+    int length = memoryManager.getRunLengthMap(encoded, sizeof(encoded));
+    std::vector<uint8_t> decoded;
+    correct = correct && length > 0 && length <= (int)sizeof(encoded) && decodeRunLengthMap(encoded, length, decoded) == 4000;
+    uint8_t* bitmap = static_cast<uint8_t*>(memoryManager.getBitmap());
+    correct = correct && decoded.size() == 500 && memcmp(bitmap + 2, decoded.data(), 500) == 0;
+    delete[] bitmap;
+    MemorySnapshot snapshot;
+    uint8_t fromSnapshot[4096];
+    memoryManager.takeSnapshot(snapshot);
+    correct = correct && snapshot.getRunLengthMap(fromSnapshot, sizeof(fromSnapshot)) == length && memcmp(encoded, fromSnapshot, length) == 0;
+
+    // a short buffer only reports the size, and damaged maps are rejected
+    correct = correct && memoryManager.getRunLengthMap(encoded, 3) == length;
+    correct = correct && decodeRunLengthMap(fromSnapshot, length - 1, decoded) == -1;
+    fromSnapshot[2] = 0x7F;
+    correct = correct && decodeRunLengthMap(fromSnapshot, length, decoded) == -1;
+
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+// two call sites the profile should tell apart
+__attribute__((noinline)) void* profiledSmall(MemoryManager& memoryManager) { return memoryManager.allocate(64); }
+__attribute__((noinline)) void* profiledLarge(MemoryManager& memoryManager) { return memoryManager.allocate(512); }
+
+unsigned int testHeapProfiler()
+{
+    std::cout << "Test Case: Sampled heap profiler" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.initialize(65535);
+    bool correct = memoryManager.writeHeapProfile((char*)"testHeapProfile.txt") == -1 && memoryManager.getProfiledCount() == 0;
+
+    // an interval of 1 samples every allocation: 10 + 5 allocated, 4 small ones freed
+    memoryManager.startProfiling(1);
+    std::vector<void*> small;
+    for (int i = 0; i < 10; i++)
+        small.push_back(profiledSmall(memoryManager));
+    for (int i = 0; i < 5; i++)
+        profiledLarge(memoryManager);
+    for (int i = 0; i < 4; i++)
+        memoryManager.free(small[i]);
+    correct = correct && memoryManager.getProfiledCount() == 11;
+    correct = correct && memoryManager.writeHeapProfile((char*)"testHeapProfile.txt") == 0;
+
+    // pprof's legacy heap format: totals, one line per call stack, then the process mappings
+    std::ifstream file("testHeapProfile.txt");
+    std::string line;
+    std::getline(file, line);
+    correct = correct && line == "heap profile: 11: 2944 [15: 3200] @ heap_v2/1";
+    // (the compiler may unroll a loop into several call sites, so stacks are added up by object size)
+    size_t inuse[2] = { 0, 0 }, allocated[2] = { 0, 0 };
+    bool mappings = false;
+    while (std::getline(file, line)) {
+        size_t inuseCount, inuseBytes, allocCount, allocBytes;
+        if (sscanf(line.c_str(), "%zu: %zu [%zu: %zu] @ 0x", &inuseCount, &inuseBytes, &allocCount, &allocBytes) == 4 && allocCount) {
+            int site = allocBytes / allocCount == 512;
+            inuse[site] += inuseCount;
+            allocated[site] += allocCount;
+        }
+        mappings = mappings || line == "MAPPED_LIBRARIES:";
+    }
+    correct = correct && inuse[0] == 6 && allocated[0] == 10 && inuse[1] == 5 && allocated[1] == 5 && mappings;
+
+    // with a real interval about one allocation per interval bytes is kept; reset forgets them all
+    memoryManager.reset();
+    memoryManager.startProfiling(4096);
+    for (int i = 0; i < 4000; i++)
+        profiledSmall(memoryManager);
+    size_t sampled = memoryManager.getProfiledCount();
+    correct = correct && sampled > 62 * 0.6 && sampled < 62 * 1.4;
+    memoryManager.reset();
+    correct = correct && memoryManager.getProfiledCount() == 0;
+
+    memoryManager.stopProfiling();
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testArenaLimits()
+{
+    std::cout << "Test Case: Arenas too big for 32-bit byte offsets are refused" << std::endl;
+    // 32768 * 65536 bytes and 65536 * 65536 bytes don't fit, even without backing memory
+    MemoryManager bigWords(32768, firstFit);
+    bigWords.setMetadataOnly(true);
+    bool correct = bigWords.initialize(65536) == -1 && bigWords.getMemoryLimit() == 0 && bigWords.allocate(8) == nullptr;
+    MemoryManager hugeWords(65536, firstFit);
+    hugeWords.setMetadataOnly(true);
+    correct = correct && hugeWords.initialize(65536) == -1 && hugeWords.getMemoryLimit() == 0;
+
+    // just under the limit works as usual
+    correct = correct && bigWords.initialize(65535) == 0 && bigWords.getMemoryLimit() == 32768u * 65535u;
+    void* first = bigWords.allocate(32768 * 3);
+    void* last = bigWords.allocate(32768 * 65532);
+    uint16_t list[8];
+    correct = correct && first && last && bigWords.getList(list, 8) == 1 && list[0] == 0;
+    bigWords.free(first);
+    correct = correct && bigWords.getList(list, 8) == 3 && list[1] == 0 && list[2] == 3;
+    bigWords.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testResourceLimits()
+{
+    std::cout << "Test Case: pmr requests too big for the arena throw bad_alloc" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.initialize(1000);
+    MemoryManagerResource<MemoryManager> resource(memoryManager);
+
+    // wrapping padded sizes, sizes past int and sizes past the arena, aligned or not
+    std::vector<std::pair<size_t, size_t>> requests = { { SIZE_MAX - 8, 64 }, { (size_t)1 << 33, 64 }, { (size_t)1 << 33, 8 }, { 8008, 8 } };
+    bool correct = true;
+    int thrown = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        try {
+            correct = correct && !resource.allocate(requests[i].first, requests[i].second);
+        }
+        catch (const std::bad_alloc&) {
+            thrown++;
+        }
+    }
+    uint16_t list[3];
+    correct = correct && thrown == 4 && memoryManager.getList(list, 3) == -1;
+
+    // the aligned path writes a header into the block, which metadata-only handles don't have
+    MemoryManager metadataManager(8, firstFit);
+    metadataManager.setMetadataOnly(true);
+    metadataManager.initialize(1000);
+    MemoryManagerResource<MemoryManager> metadataResource(metadataManager);
+    try {
+        correct = correct && !metadataResource.allocate(100, 64);
+    }
+    catch (const std::bad_alloc&) {
+    }
+
+    metadataManager.shutdown();
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+// word offset a long-lived or permanent 3 word block gets, with holes [0, 4] - [6, 4] - [12, 14] - [28, 12]
+template<class Policy> int placeLongLived(Lifetime hint)
+{
+    BasicMemoryManager<Policy, 8> memoryManager;
+    memoryManager.initialize(40);
+    std::vector<void*> blocks;
+    for (size_t words : { 4, 2, 4, 2, 14, 2 })
+        blocks.push_back(memoryManager.allocate(8 * words));
+    memoryManager.free(blocks[0]);
+    memoryManager.free(blocks[2]);
+    memoryManager.free(blocks[4]);
+    uint8_t* block = static_cast<uint8_t*>(memoryManager.allocate(8 * 3, hint));
+    int word = block ? (block - static_cast<uint8_t*>(memoryManager.getMemoryStart())) / 8 : -1;
+    memoryManager.shutdown();
+    return word;
+}
+
+unsigned int testPolicyLifetimeHints()
+{
+    std::cout << "Test Case: Compile-time policies choose the hole for long-lived blocks" << std::endl;
+    // long-lived blocks go to the top of the hole the policy picks from the top of the arena,
+    // permanent ones always to the highest hole that fits
+    bool correct = placeLongLived<BestFitPolicy>(LIFETIME_LONG) == 7 && placeLongLived<WorstFitPolicy>(LIFETIME_LONG) == 23
+        && placeLongLived<FirstFitPolicy>(LIFETIME_LONG) == 37 && placeLongLived<NextFitPolicy>(LIFETIME_LONG) == 37;
+    correct = correct && placeLongLived<BestFitPolicy>(LIFETIME_PERMANENT) == 37 && placeLongLived<WorstFitPolicy>(LIFETIME_PERMANENT) == 37;
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testLargeObjectTrace()
+{
+    std::cout << "Test Case: Large objects are recorded in traces and replayed" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.initialize(100);
+    memoryManager.setLargeObjectThreshold(256);
+    memoryManager.startTrace((char*)"testLargeObjectTrace.trace");
+    memoryManager.allocate(64);
+    void* large1 = memoryManager.allocate(1000);
+    void* large2 = memoryManager.allocate(500);
+    memoryManager.free(large1);
+    memoryManager.allocate(64);
+    memoryManager.free(large2);
+    memoryManager.stopTrace();
+    memoryManager.shutdown();
+
+    std::vector<uint8_t> trace;
+    bool correct = loadTrace((char*)"testLargeObjectTrace.trace", trace) == 0;
+    unlink("testLargeObjectTrace.trace");
+    int largeOps = 0;
+    for (size_t i = 0; correct && i < getTraceRecordCount(trace.size()); ++i) {
+        TraceRecord record = readTraceRecord(trace.data(), i);
+        largeOps += record.op == TRACE_ALLOCATE_LARGE || record.op == TRACE_FREE_LARGE;
+    }
+
+    // the arena holds 64 bytes while both large objects are mapped
+    ReplayReport report = replayTrace(trace.data(), trace.size(), 0, 0, firstFit, 0);
+    correct = correct && largeOps == 4 && report.operations == 6 && report.allocations == 4 && report.frees == 2 && report.failures == 0
+        && report.peakBytesInUse == 1564 && report.peakFootprintBytes == 1564;
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testShardAssignmentPerManager()
+{
+    std::cout << "Test Case: Each sharded manager hands out its own thread slots" << std::endl;
+    ShardedMemoryManager twoShards(2, 8, firstFit, SHARD_BY_THREAD);
+    ShardedMemoryManager threeShards(3, 8, firstFit, SHARD_BY_THREAD);
+    unsigned first = 0, second = 0, third = 0;
+    // two threads take the first manager's slots 0 and 1, then a new thread is the first to use the other manager
+    std::thread([&]() { first = twoShards.getCurrentShard(); }).join();
+    std::thread([&]() { second = twoShards.getCurrentShard(); }).join();
+    std::thread([&]() { third = threeShards.getCurrentShard(); }).join();
+    unsigned mainTwo = twoShards.getCurrentShard(), mainThree = threeShards.getCurrentShard();
+    bool correct = first == 0 && second == 1 && third == 0 && mainTwo == 0 && mainThree == 1;
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+// allocate(0) gives nullptr and the arena carries on as if it never happened
+template<class Manager> bool allocateZeroBytes(Manager& memoryManager)
+{
+    memoryManager.initialize(26);
+    void* block = memoryManager.allocate(16);
+    void* empty = memoryManager.allocate(0);
+    void* emptyLong = memoryManager.allocate(0, LIFETIME_LONG);
+    void* next = memoryManager.allocate(8);
+    bool correct = block && !empty && !emptyLong && next && next != block;
+    memoryManager.free(block);
+    memoryManager.free(next);
+    uint16_t list[3];
+    correct = correct && memoryManager.getList(list, 3) == 3 && list[0] == 1 && list[1] == 0 && list[2] == 26;
+    memoryManager.shutdown();
+    return correct;
+}
+
+unsigned int testZeroByteAllocate()
+{
+    std::cout << "Test Case: allocate(0) returns nullptr and leaves the arena intact" << std::endl;
+    // the kernel best fit, a custom callback and a compile-time policy all used to carve an empty block
+    MemoryManager bestFitManager(8, bestFit);
+    MemoryManager customManager(8, [](int sizeInWords, void* list) { return bestFit(sizeInWords, list); });
+    BasicMemoryManager<BestFitPolicy, 8> policyManager;
+    bool correct = allocateZeroBytes(bestFitManager) && allocateZeroBytes(customManager) && allocateZeroBytes(policyManager);
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testTraceWhileMaintaining()
+{
+    std::cout << "Test Case: Traces start and stop while the maintenance worker drains deferred frees" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.setMaintenanceInterval(1);
+    memoryManager.initialize(4096);
+    bool correct = true;
+    // the worker frees blocks queued here and records them in whichever trace is current
+    for (int round = 0; round < 50 && correct; round++) {
+        correct = memoryManager.startTrace((char*)"testTraceWhileMaintaining.trace") == 0;
+        std::vector<void*> blocks;
+        for (int i = 0; i < 32; i++)
+            blocks.push_back(memoryManager.allocate(64));
+        std::thread freeing([&]() {
+            for (size_t i = 0; i < blocks.size(); i++)
+                memoryManager.freeDeferred(blocks[i]);
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        memoryManager.stopTrace();
+        freeing.join();
+        memoryManager.setInteriorFree(round % 2 == 0);
+        memoryManager.drainDeferred();
+    }
+    unlink("testTraceWhileMaintaining.trace");
+    uint16_t list[3];
+    correct = correct && memoryManager.getDeferredCount() == 0 && memoryManager.getList(list, 3) == 3 && list[2] == 4096;
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testProfilingWhileMaintaining()
+{
+    std::cout << "Test Case: Profiling starts and stops while the maintenance worker drains deferred frees" << std::endl;
+    MemoryManager memoryManager(8, firstFit);
+    memoryManager.setMaintenanceInterval(1);
+    memoryManager.initialize(4096);
+    bool correct = true;
+    // the worker frees blocks queued here and reports them to whichever profiler is current
+    for (int round = 0; round < 50 && correct; round++) {
+        memoryManager.startProfiling(1);
+        std::vector<void*> blocks;
+        for (int i = 0; i < 32; i++)
+            blocks.push_back(memoryManager.allocate(64));
+        std::thread freeing([&]() {
+            for (size_t i = 0; i < blocks.size(); i++)
+                memoryManager.freeDeferred(blocks[i]);
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        correct = memoryManager.getProfiledCount() <= 32 && memoryManager.writeHeapProfile((char*)"testProfilingWhileMaintaining.txt") == 0;
+        memoryManager.stopProfiling();
+        freeing.join();
+        memoryManager.drainDeferred();
+    }
+    unlink("testProfilingWhileMaintaining.txt");
+    correct = correct && memoryManager.getDeferredCount() == 0 && memoryManager.getProfiledCount() == 0;
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
+
+unsigned int testLifetimeNextFit()
+{
+    std::cout << "Test Case: Lifetime hints with a next-fit callback" << std::endl;
+    MemoryManager memoryManager(8, NextFit());
+    memoryManager.initialize(20);
+
+    uint64_t* testArray1 = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 4));
+    memoryManager.allocate(sizeof(uint64_t) * 4);
+    memoryManager.allocate(sizeof(uint64_t) * 4);
+    memoryManager.free(testArray1);
+
+    // the long-lived block goes to the top of the arena, not the low hole and without moving the cursor
+    uint64_t* longLived = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 2, LIFETIME_LONG));
+    uint64_t* shortLived = static_cast<uint64_t*>(memoryManager.allocate(sizeof(uint64_t) * 2));
+    uint64_t* start = static_cast<uint64_t*>(memoryManager.getMemoryStart());
+    bool correct = longLived == start + 18 && shortLived == start + 12;
+
+    std::vector<uint16_t> correctList = { 0, 4, 14, 4 };
+    unsigned int score = testGetList(memoryManager, correctList.size() * 2, correctList) && correct ? 1 : 0;
+    memoryManager.shutdown();
+    return score;
+}
+
+unsigned int testReadersWhileMaintaining()
+{
+    std::cout << "Test Case: Readers see consistent holes while the maintenance worker drains deferred frees" << std::endl;
+    // a custom callback builds its list inside allocate, which already holds the lock the readers now take
+    MemoryManager memoryManager(8, [](int sizeInWords, void* list) { return bestFit(sizeInWords, list); });
+    memoryManager.setMaintenanceInterval(1);
+    memoryManager.initialize(4096);
+    bool correct = true;
+    std::vector<uint16_t> list(2 * 4096 + 1);
+    for (int round = 0; round < 50 && correct; round++) {
+        std::vector<void*> blocks;
+        for (int i = 0; i < 32; i++)
+            blocks.push_back(memoryManager.allocate(64));
+        std::atomic<bool> done(false);
+        std::thread freeing([&]() {
+            for (size_t i = 0; i < blocks.size(); i++)
+                memoryManager.freeDeferred(blocks[i]);
+            done = true;
+        });
+        // holes must come back in address order without overlapping, however far the worker has got
+        while (correct && !done) {
+            int length = memoryManager.getList(list.data(), list.size());
+            int end = 0;
+            for (int j = 0; j < list[0] && correct; j++) {
+                correct = list[(2 * j) + 1] >= end && list[(2 * j) + 2] > 0;
+                end = list[(2 * j) + 1] + list[(2 * j) + 2];
+            }
+            correct = correct && length == (2 * list[0]) + 1 && end <= 4096 && memoryManager.getDeferredCount() <= blocks.size();
+            uint16_t* copy = static_cast<uint16_t*>(memoryManager.getList());
+            correct = correct && copy != nullptr;
+            delete[] copy;
+            correct = correct && memoryManager.getHoleCount() >= 1;
+        }
+        freeing.join();
+        memoryManager.drainDeferred();
+    }
+    correct = correct && memoryManager.getDeferredCount() == 0 && memoryManager.getList(list.data(), 3) == 3 && list[1] == 0 && list[2] == 4096;
+    memoryManager.shutdown();
+    std::cout << (correct ? "[CORRECT]\n" : "[INCORRECT]\n") << std::endl;
+    return correct ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+#include "GrowableMemoryManager.h"
+
+GrowableMemoryManager::GrowableMemoryManager(unsigned wordSize, std::function<int(int, void*)> allocator, double growthFactor)
+{
+	this->wordSize = wordSize;
+	this->allocator = allocator;
+	this->growthFactor = growthFactor < 1 ? 1 : growthFactor;
+	this->lastChunkWords = 0;
+	this->first = nullptr;
+}
+GrowableMemoryManager::~GrowableMemoryManager()
+{
+	shutdown();
+}
+int GrowableMemoryManager::initialize(size_t sizeInWords)
+{
+	//Same rules as MemoryManager::initialize for the first chunk, returns 0 or -1; re-initializing drops every chunk
+	shutdown();
+	if (sizeInWords == 0 || sizeInWords > MAX_CHUNK_WORDS)
+		return -1;
+	this->first = addChunk(sizeInWords);
+	return this->first ? 0 : -1;
+}
+void GrowableMemoryManager::shutdown()
+{
+	this->chunks.clear();
+	this->first = nullptr;
+	this->lastChunkWords = 0;
+}
+void* GrowableMemoryManager::allocate(size_t sizeInBytes)
+{
+	//Not initialized, nothing to grow from
+	if (!this->first || sizeInBytes == 0)
+		return nullptr;
+
+	//Only ask chunks whose largest hole could fit the request
+	size_t words = (sizeInBytes + this->wordSize - 1) / this->wordSize;
+	for (size_t i = 0; i < this->chunks.size(); i++)
+	{
+		if (this->chunks[i]->getHoleIndex().getLargest() < words)
+			continue;
+		void* p = this->chunks[i]->allocate(sizeInBytes);
+		if (p)
+			return p;
+	}
+
+	//Nothing fits: grow geometrically, but always by at least the request
+	if (words > MAX_CHUNK_WORDS)
+		return nullptr;
+	size_t chunkWords = (size_t)(this->lastChunkWords * this->growthFactor);
+	chunkWords = min((size_t)MAX_CHUNK_WORDS, max(chunkWords, words));
+	MemoryManager* chunk = addChunk(chunkWords);
+	if (!chunk)
+		return nullptr;
+	return chunk->allocate(sizeInBytes);
+}
+void GrowableMemoryManager::free(void* address)
+{
+	size_t index = findChunk(address);
+	if (index == this->chunks.size())
+		return;
+	MemoryManager* chunk = this->chunks[index].get();
+	chunk->free(address);
+
+	//Hand wholly empty chunks back, the first one stays so the manager never shrinks below its initial size
+	if (chunk != this->first && isEmpty(chunk))
+		releaseChunk(index);
+}
+void GrowableMemoryManager::setGrowthFactor(double growthFactor)
+{
+	//Applies to chunks added from now on
+	this->growthFactor = growthFactor < 1 ? 1 : growthFactor;
+}
+unsigned GrowableMemoryManager::getWordSize()
+{
+	return this->wordSize;
+}
+size_t GrowableMemoryManager::getMemoryLimit()
+{
+	//Total bytes over all chunks currently held
+	size_t total = 0;
+	for (size_t i = 0; i < this->chunks.size(); i++)
+		total += this->chunks[i]->getMemoryLimit();
+	return total;
+}
+size_t GrowableMemoryManager::getChunkCount()
+{
+	return this->chunks.size();
+}
+MemoryManager* GrowableMemoryManager::addChunk(size_t sizeInWords)
+{
+	unique_ptr<MemoryManager> chunk(new MemoryManager(this->wordSize, this->allocator));
+	if (chunk->initialize(sizeInWords) < 0)
+		return nullptr;
+	this->lastChunkWords = sizeInWords;
+
+	//keep the chunks in address order for findChunk()
+	vector<unique_ptr<MemoryManager>>::iterator position = this->chunks.begin();
+	while (position != this->chunks.end() && (*position)->getMemoryStart() < chunk->getMemoryStart())
+		position++;
+	return this->chunks.insert(position, move(chunk))->get();
+}
+void GrowableMemoryManager::releaseChunk(size_t index)
+{
+	this->chunks.erase(this->chunks.begin() + index);
+}
+size_t GrowableMemoryManager::findChunk(void* address)
+{
+	//Binary search for the last chunk starting at or before address, then check the address is inside it
+	size_t low = 0, high = this->chunks.size();
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if ((uint8_t*)this->chunks[mid]->getMemoryStart() <= (uint8_t*)address)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == 0)
+		return this->chunks.size();
+	uint8_t* start = (uint8_t*)this->chunks[low - 1]->getMemoryStart();
+	if ((uint8_t*)address >= start + this->chunks[low - 1]->getMemoryLimit())
+		return this->chunks.size();
+	return low - 1;
+}
+bool GrowableMemoryManager::isEmpty(MemoryManager* chunk)
+{
+	//no blocks left means the whole arena is one hole again
+	return chunk->getHoleCount() == 1 && (unsigned)chunk->getHoleSizeBytes(0) == chunk->getMemoryLimit();
+}
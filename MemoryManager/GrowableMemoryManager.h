@@ -0,0 +1,41 @@
+/*
+	Memory manager that grows instead of failing. It owns a list of MemoryManager chunks, each with its own
+	arena, holes and blocks; when no chunk can hold a request a new chunk is added, growthFactor times the size
+	of the last one (capped at the 65535-word limit of a single arena). Chunks are kept sorted by arena address
+	so free() finds the owning chunk with a binary search, and a chunk whose blocks have all been freed is
+	released, except the first one.
+*/
+
+#include "MemoryManager.h"
+#include <memory>
+#pragma once
+
+#define MAX_CHUNK_WORDS 65535 //largest arena whose hole sizes fit the 16-bit getList() format
+
+class GrowableMemoryManager
+{
+public:
+	GrowableMemoryManager(unsigned wordSize, std::function<int(int, void*)> allocator, double growthFactor = 2);
+	GrowableMemoryManager(const GrowableMemoryManager&) = delete;
+	GrowableMemoryManager& operator = (const GrowableMemoryManager&) = delete;
+	~GrowableMemoryManager();
+	int initialize(size_t sizeInWords);
+	void shutdown();
+	void* allocate(size_t sizeInBytes);
+	void free(void* address);
+	void setGrowthFactor(double growthFactor);
+	unsigned getWordSize();
+	size_t getMemoryLimit();
+	size_t getChunkCount();
+private:
+	MemoryManager* addChunk(size_t sizeInWords);
+	void releaseChunk(size_t index);
+	size_t findChunk(void* address);
+	bool isEmpty(MemoryManager* chunk);
+	unsigned wordSize;
+	std::function<int(int, void*)> allocator;
+	double growthFactor;
+	size_t lastChunkWords;
+	MemoryManager* first; //owned by chunks
+	vector<unique_ptr<MemoryManager>> chunks; //sorted by arena address
+};
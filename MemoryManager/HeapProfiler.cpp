@@ -0,0 +1,110 @@
+#include "HeapProfiler.h"
+#include <execinfo.h>
+#include <cmath>
+
+HeapProfiler::HeapProfiler(size_t sampleInterval)
+{
+	this->sampleInterval = sampleInterval;
+	this->random = 0x9E3779B97F4A7C15ull;
+	this->bytesUntilSample = pickNextSample();
+}
+int64_t HeapProfiler::pickNextSample()
+{
+	//Exponentially distributed with mean sampleInterval; an interval of 0 or 1 samples every allocation
+	if (this->sampleInterval <= 1)
+		return 0;
+	this->random ^= this->random << 13;
+	this->random ^= this->random >> 7;
+	this->random ^= this->random << 17;
+	//53 random bits -> uniform in (0, 1]
+	double uniform = ((this->random >> 11) + 1) * (1.0 / 9007199254740992.0);
+	return (int64_t)(-log(uniform) * this->sampleInterval);
+}
+void HeapProfiler::recordAllocate(void* address, size_t sizeInBytes)
+{
+	this->bytesUntilSample = pickNextSample();
+
+	void* frames[HEAP_PROFILE_DEPTH];
+	int depth = backtrace(frames, HEAP_PROFILE_DEPTH);
+	StackEntry stack = this->stacks.insert(make_pair(vector<void*>(frames, frames + depth), StackTotals())).first;
+	stack->second.inuseCount++;
+	stack->second.inuseBytes += sizeInBytes;
+	stack->second.allocCount++;
+	stack->second.allocBytes += sizeInBytes;
+	this->live[address] = make_pair(sizeInBytes, stack);
+}
+void HeapProfiler::recordFree(void* address)
+{
+	//Nearly every free is of an unsampled block, so this is usually one failed lookup in a small table
+	map<void*, pair<size_t, StackEntry>>::iterator sample = this->live.find(address);
+	if (sample == this->live.end())
+		return;
+	sample->second.second->second.inuseCount--;
+	sample->second.second->second.inuseBytes -= sample->second.first;
+	this->live.erase(sample);
+}
+void HeapProfiler::clearLive()
+{
+	//Everything was freed at once (reset/shutdown)
+	for (StackEntry stack = this->stacks.begin(); stack != this->stacks.end(); stack++)
+	{
+		stack->second.inuseCount = 0;
+		stack->second.inuseBytes = 0;
+	}
+	this->live.clear();
+}
+size_t HeapProfiler::getSampleInterval()
+{
+	return this->sampleInterval;
+}
+size_t HeapProfiler::getLiveSampleCount()
+{
+	return this->live.size();
+}
+int HeapProfiler::write(char* filename)
+{
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
+	if (fd == -1)
+		return -1;
+
+	StackTotals total = {};
+	string lines = "";
+	char text[64];
+	for (StackEntry stack = this->stacks.begin(); stack != this->stacks.end(); stack++)
+	{
+		total.inuseCount += stack->second.inuseCount;
+		total.inuseBytes += stack->second.inuseBytes;
+		total.allocCount += stack->second.allocCount;
+		total.allocBytes += stack->second.allocBytes;
+		snprintf(text, sizeof(text), "%zu: %zu [%zu: %zu] @", stack->second.inuseCount, stack->second.inuseBytes, stack->second.allocCount, stack->second.allocBytes);
+		lines += text;
+		for (size_t i = 0; i < stack->first.size(); i++)
+		{
+			snprintf(text, sizeof(text), " %p", stack->first[i]);
+			lines += text;
+		}
+		lines += "\n";
+	}
+	snprintf(text, sizeof(text), "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n", total.inuseCount, total.inuseBytes, total.allocCount, total.allocBytes, this->sampleInterval);
+	string data = text + lines + "\nMAPPED_LIBRARIES:\n";
+
+	//pprof maps the addresses back to binaries and symbols with the process's mappings
+	int maps = open("/proc/self/maps", O_RDONLY);
+	if (maps != -1)
+	{
+		char chunk[4096];
+		ssize_t got;
+		while ((got = read(maps, chunk, sizeof(chunk))) > 0)
+			data.append(chunk, got);
+		close(maps);
+	}
+
+	if (::write(fd, data.c_str(), data.size()) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	if (close(fd) == -1)
+		return -1;
+	return 0;
+}
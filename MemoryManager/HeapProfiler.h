@@ -0,0 +1,52 @@
+/*
+	Sampled heap profiler (see MemoryManagerBase::startProfiling). Rather than every call, about one allocation per
+	sampleInterval bytes is recorded: a countdown of bytes is drawn from an exponential distribution (a Poisson process
+	over allocated bytes, as in tcmalloc), so big allocations are proportionally more likely to be picked and no call
+	site is favoured by allocation order. A sampled allocation keeps its stack (backtrace) in a side table until freed.
+
+	Profiles are written in the legacy text heap format pprof reads (the gperftools "heap_v2" flavour):
+		heap profile: <inuse objects>: <inuse bytes> [<alloc objects>: <alloc bytes>] @ heap_v2/<sampleInterval>
+		<inuse objects>: <inuse bytes> [<alloc objects>: <alloc bytes>] @ 0x<pc> 0x<pc> ...   (one line per stack)
+		MAPPED_LIBRARIES:
+		<contents of /proc/self/maps>
+	Counts are of samples; pprof scales them back up using the interval.
+*/
+
+#include "MemoryManager.h"
+#include <stdint.h>
+#pragma once
+
+#define HEAP_PROFILE_DEPTH 32
+
+class HeapProfiler
+{
+public:
+	HeapProfiler(size_t sampleInterval);
+	//Counts sizeInBytes off the distance to the next sample; true if this allocation is the one to record
+	bool shouldSample(size_t sizeInBytes)
+	{
+		this->bytesUntilSample -= (int64_t)sizeInBytes;
+		return this->bytesUntilSample < 0;
+	}
+	void recordAllocate(void* address, size_t sizeInBytes);
+	void recordFree(void* address);
+	void clearLive();
+	size_t getSampleInterval();
+	size_t getLiveSampleCount();
+	int write(char* filename);
+private:
+	struct StackTotals
+	{
+		size_t inuseCount;
+		size_t inuseBytes;
+		size_t allocCount;
+		size_t allocBytes;
+	};
+	typedef map<vector<void*>, StackTotals>::iterator StackEntry;
+	int64_t pickNextSample();
+	size_t sampleInterval;
+	int64_t bytesUntilSample;
+	uint64_t random; //xorshift state
+	map<vector<void*>, StackTotals> stacks; //per call stack, every sample ever taken
+	map<void*, pair<size_t, StackEntry>> live; //sampled address -> (size, stack), until freed
+};
@@ -0,0 +1,151 @@
+#include "HoleIndex.h"
+
+HoleIndex::HoleIndex()
+{
+	this->leaves = 0;
+}
+void HoleIndex::reset(unsigned totalWords)
+{
+	//round the leaf count up to a power of two so the tree is complete
+	this->leaves = 1;
+	while (this->leaves < totalWords)
+		this->leaves <<= 1;
+	this->maxSize.assign(2 * this->leaves, 0);
+}
+void HoleIndex::set(unsigned startWord, unsigned sizeWords)
+{
+	if (startWord >= this->leaves)
+		return;
+
+	//update the leaf, then recompute the max along the path to the root
+	unsigned node = this->leaves + startWord;
+	this->maxSize[node] = sizeWords;
+	for (node >>= 1; node >= 1; node >>= 1)
+	{
+		uint32_t largest = std::max(this->maxSize[2 * node], this->maxSize[2 * node + 1]);
+		if (this->maxSize[node] == largest)
+			break;
+		this->maxSize[node] = largest;
+	}
+}
+void HoleIndex::remove(unsigned startWord)
+{
+	set(startWord, 0);
+}
+int HoleIndex::firstFit(unsigned sizeWords)
+{
+	//Returns the word offset of the lowest-addressed hole with at least sizeWords words, or -1
+	if (this->leaves == 0 || sizeWords == 0 || this->maxSize[1] < sizeWords)
+		return -1;
+
+	unsigned node = 1;
+	while (node < this->leaves)
+	{
+		if (this->maxSize[2 * node] >= sizeWords)
+			node = 2 * node;
+		else
+			node = 2 * node + 1;
+	}
+	return node - this->leaves;
+}
+int HoleIndex::lastFit(unsigned sizeWords)
+{
+	//Returns the word offset of the highest-addressed hole with at least sizeWords words, or -1
+	if (this->leaves == 0 || sizeWords == 0 || this->maxSize[1] < sizeWords)
+		return -1;
+
+	unsigned node = 1;
+	while (node < this->leaves)
+	{
+		if (this->maxSize[2 * node + 1] >= sizeWords)
+			node = 2 * node + 1;
+		else
+			node = 2 * node;
+	}
+	return node - this->leaves;
+}
+int HoleIndex::firstFitFrom(unsigned fromWord, unsigned sizeWords)
+{
+	//Lowest-addressed hole starting at or after fromWord with at least sizeWords words, or -1
+	if (this->leaves == 0 || sizeWords == 0)
+		return -1;
+	return firstFitFrom(1, 0, this->leaves, fromWord, sizeWords);
+}
+int HoleIndex::worstFit(unsigned sizeWords)
+{
+	//Lowest-addressed of the largest holes, or -1 if even the largest one is too small
+	if (this->leaves == 0 || sizeWords == 0 || this->maxSize[1] < sizeWords)
+		return -1;
+
+	unsigned node = 1;
+	while (node < this->leaves)
+	{
+		if (this->maxSize[2 * node] == this->maxSize[node])
+			node = 2 * node;
+		else
+			node = 2 * node + 1;
+	}
+	return node - this->leaves;
+}
+int HoleIndex::lastWorstFit(unsigned sizeWords)
+{
+	//Highest-addressed of the largest holes, or -1 if even the largest one is too small
+	if (this->leaves == 0 || sizeWords == 0 || this->maxSize[1] < sizeWords)
+		return -1;
+
+	unsigned node = 1;
+	while (node < this->leaves)
+	{
+		if (this->maxSize[2 * node + 1] == this->maxSize[node])
+			node = 2 * node + 1;
+		else
+			node = 2 * node;
+	}
+	return node - this->leaves;
+}
+int HoleIndex::lastHoleBefore(unsigned word)
+{
+	//Start of the highest-addressed hole starting before word, or -1
+	if (this->leaves == 0)
+		return -1;
+	return lastHoleBefore(1, 0, this->leaves, word);
+}
+unsigned HoleIndex::getSize(unsigned startWord)
+{
+	if (startWord >= this->leaves)
+		return 0;
+	return this->maxSize[this->leaves + startWord];
+}
+int HoleIndex::firstFitFrom(unsigned node, unsigned low, unsigned high, unsigned fromWord, unsigned sizeWords)
+{
+	//node covers words [low, high); skip subtrees left of fromWord or without a big enough hole
+	if (high <= fromWord || this->maxSize[node] < sizeWords)
+		return -1;
+	if (node >= this->leaves)
+		return low;
+
+	unsigned mid = (low + high) / 2;
+	int found = firstFitFrom(2 * node, low, mid, fromWord, sizeWords);
+	if (found >= 0)
+		return found;
+	return firstFitFrom(2 * node + 1, mid, high, fromWord, sizeWords);
+}
+int HoleIndex::lastHoleBefore(unsigned node, unsigned low, unsigned high, unsigned word)
+{
+	if (low >= word || this->maxSize[node] == 0)
+		return -1;
+	if (node >= this->leaves)
+		return low;
+
+	unsigned mid = (low + high) / 2;
+	int found = lastHoleBefore(2 * node + 1, mid, high, word);
+	if (found >= 0)
+		return found;
+	return lastHoleBefore(2 * node, low, mid, word);
+}
+unsigned HoleIndex::getLargest()
+{
+	if (this->leaves == 0)
+		return 0;
+	return this->maxSize[1];
+}
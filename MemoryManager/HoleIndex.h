@@ -0,0 +1,33 @@
+/*
+	Address-ordered hole index augmented with the largest hole size in every subtree.
+	The arena is at most 65536 words, so the tree is an implicit, perfectly balanced binary tree over word offsets
+	(stored in one array, no rebalancing): leaf i holds the size of the hole starting at word i, or 0.
+	Every node holds the max of its children, so the lowest-addressed hole that fits is found in O(log n)
+	by always descending into the leftmost child whose max is big enough.
+*/
+
+#include <stdint.h>
+#include <vector>
+#pragma once
+
+class HoleIndex
+{
+public:
+	HoleIndex();
+	void reset(unsigned totalWords);
+	void set(unsigned startWord, unsigned sizeWords);
+	void remove(unsigned startWord);
+	int firstFit(unsigned sizeWords);
+	int lastFit(unsigned sizeWords);
+	int firstFitFrom(unsigned fromWord, unsigned sizeWords);
+	int worstFit(unsigned sizeWords);
+	int lastWorstFit(unsigned sizeWords);
+	int lastHoleBefore(unsigned word);
+	unsigned getSize(unsigned startWord);
+	unsigned getLargest();
+private:
+	int firstFitFrom(unsigned node, unsigned low, unsigned high, unsigned fromWord, unsigned sizeWords);
+	int lastHoleBefore(unsigned node, unsigned low, unsigned high, unsigned word);
+	unsigned leaves;
+	std::vector<uint32_t> maxSize; //maxSize[1] is the root, children of n are 2n and 2n + 1
+};
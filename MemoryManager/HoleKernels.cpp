@@ -0,0 +1,152 @@
+#include "HoleKernels.h"
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HOLE_KERNELS_X86
+#endif
+
+//Scalar version, also used for the tail the vector versions leave over
+static uint32_t minFitting(const uint32_t* sizes, int from, int count, uint32_t needBytes, uint32_t smallest)
+{
+	for (int i = from; i < count; i++)
+		if (sizes[i] >= needBytes && sizes[i] < smallest)
+			smallest = sizes[i];
+	return smallest;
+}
+static uint32_t minStartOf(const uint32_t* sizes, const uint32_t* starts, int from, int count, uint32_t value, uint32_t lowest)
+{
+	for (int i = from; i < count; i++)
+		if (sizes[i] == value && starts[i] < lowest)
+			lowest = starts[i];
+	return lowest;
+}
+static int findBestFitScalar(const uint32_t* sizes, const uint32_t* starts, int count, uint32_t needBytes)
+{
+	int best = -1;
+	for (int i = 0; i < count; i++)
+		if (sizes[i] >= needBytes && (best < 0 || sizes[i] < sizes[best] || (sizes[i] == sizes[best] && starts[i] < starts[best])))
+			best = i;
+	return best < 0 ? -1 : (int)starts[best];
+}
+
+/*
+	Vector versions take two passes, both straight streams over the arrays: the smallest fitting size (sizes that
+	don't fit count as UINT32_MAX), then the lowest start among holes of exactly that size. No hole is anywhere
+	near 4GB, so UINT32_MAX after the first pass means nothing fits.
+*/
+#ifdef HOLE_KERNELS_X86
+__attribute__((target("avx2")))
+static uint32_t reduceMinAvx2(__m256i lanes)
+{
+	__m128i half = _mm_min_epu32(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+	half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return (uint32_t)_mm_cvtsi128_si32(half);
+}
+__attribute__((target("avx2")))
+static int findBestFitAvx2(const uint32_t* sizes, const uint32_t* starts, int count, uint32_t needBytes)
+{
+	__m256i need = _mm256_set1_epi32((int)needBytes);
+	__m256i none = _mm256_set1_epi32(-1);
+	__m256i smallest = none;
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i size = _mm256_loadu_si256((const __m256i*)(sizes + i));
+		//unsigned size >= need  <=>  max(size, need) == size
+		__m256i fits = _mm256_cmpeq_epi32(_mm256_max_epu32(size, need), size);
+		smallest = _mm256_min_epu32(smallest, _mm256_blendv_epi8(none, size, fits));
+	}
+	uint32_t best = minFitting(sizes, i, count, needBytes, reduceMinAvx2(smallest));
+	if (best == UINT32_MAX)
+		return -1;
+
+	__m256i target = _mm256_set1_epi32((int)best);
+	__m256i lowest = none;
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		__m256i match = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(sizes + i)), target);
+		lowest = _mm256_min_epu32(lowest, _mm256_blendv_epi8(none, _mm256_loadu_si256((const __m256i*)(starts + i)), match));
+	}
+	return (int)minStartOf(sizes, starts, i, count, best, reduceMinAvx2(lowest));
+}
+
+__attribute__((target("avx512f")))
+static uint32_t reduceMinAvx512(__m512i lanes)
+{
+	//through memory: GCC's _mm512_reduce_min_epu32 trips -Wuninitialized
+	uint32_t values[16];
+	_mm512_storeu_si512((void*)values, lanes);
+	return minFitting(values, 0, 16, 0, UINT32_MAX);
+}
+__attribute__((target("avx512f")))
+static int findBestFitAvx512(const uint32_t* sizes, const uint32_t* starts, int count, uint32_t needBytes)
+{
+	__m512i need = _mm512_set1_epi32((int)needBytes);
+	__m512i smallest = _mm512_set1_epi32(-1);
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512i size = _mm512_loadu_si512((const void*)(sizes + i));
+		__mmask16 fits = _mm512_cmpge_epu32_mask(size, need);
+		smallest = _mm512_mask_min_epu32(smallest, fits, smallest, size);
+	}
+	uint32_t best = minFitting(sizes, i, count, needBytes, reduceMinAvx512(smallest));
+	if (best == UINT32_MAX)
+		return -1;
+
+	__m512i target = _mm512_set1_epi32((int)best);
+	__m512i lowest = _mm512_set1_epi32(-1);
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		__mmask16 match = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512((const void*)(sizes + i)), target);
+		lowest = _mm512_mask_min_epu32(lowest, match, lowest, _mm512_loadu_si512((const void*)(starts + i)));
+	}
+	return (int)minStartOf(sizes, starts, i, count, best, reduceMinAvx512(lowest));
+}
+#endif
+
+//Runtime dispatch: resolved once, on first use
+struct HoleKernels
+{
+	BestFitKernel bestFit;
+	const char* name;
+};
+static HoleKernels selectKernels()
+{
+#ifdef HOLE_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return { findBestFitAvx512, "avx512" };
+	if (__builtin_cpu_supports("avx2"))
+		return { findBestFitAvx2, "avx2" };
+#endif
+	return { findBestFitScalar, "scalar" };
+}
+static const HoleKernels& getKernels()
+{
+	static const HoleKernels kernels = selectKernels();
+	return kernels;
+}
+
+int findBestFit(const uint32_t* sizes, const uint32_t* starts, int count, uint32_t needBytes)
+{
+	return getKernels().bestFit(sizes, starts, count, needBytes);
+}
+const char* getHoleKernelName()
+{
+	return getKernels().name;
+}
+BestFitKernel getBestFitKernel(const char* name)
+{
+	if (strcmp(name, "scalar") == 0)
+		return findBestFitScalar;
+#ifdef HOLE_KERNELS_X86
+	__builtin_cpu_init();
+	if (strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f"))
+		return findBestFitAvx512;
+	if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+		return findBestFitAvx2;
+#endif
+	return nullptr;
+}
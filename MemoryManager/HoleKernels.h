@@ -0,0 +1,21 @@
+/*
+	Scan kernel over the contiguous hole start/size arrays (see MemoryManagerBase::getHoleSizes). Best fit has no
+	index to answer it (worst fit does: HoleIndex keeps the max per subtree), so it stays a linear scan, but it
+	compares 8 (AVX2) or 16 (AVX-512) sizes per instruction. The widest version the CPU supports is picked once
+	at startup; other CPUs get the scalar loop.
+*/
+
+#include <stdint.h>
+#pragma once
+
+//Start of the hole with the smallest size >= needBytes, lowest start on ties (the arrays are in no
+//particular order), or -1 if none fits
+int findBestFit(const uint32_t* sizes, const uint32_t* starts, int count, uint32_t needBytes);
+
+//Name of the kernel set in use ("avx512", "avx2" or "scalar")
+const char* getHoleKernelName();
+
+//One version by name, nullptr if it isn't compiled in or this CPU can't run it, so tests can check every
+//version the machine supports against the scalar one
+typedef int (*BestFitKernel)(const uint32_t* sizes, const uint32_t* starts, int count, uint32_t needBytes);
+BestFitKernel getBestFitKernel(const char* name);
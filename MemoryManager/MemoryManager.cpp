@@ -1,28 +1,99 @@
 #include "MemoryManager.h"
+#include "AllocationTrace.h"
+#include "MemoryMapWriter.h"
+#include "HeapProfiler.h"
 
 //Memory Manager class functions
-MemoryManager::MemoryManager(unsigned wordSize, std::function<int(int, void*)> allocator)
+MemoryManagerBase::MemoryManagerBase(unsigned wordSize)
 {
 	this->wordSize = wordSize;
-	this->allocator = allocator;
 	this->bytes = 0;
 	this->totalWords = 0;
 	this->allocated = false;
+	this->metadataOnly = false;
+	this->interiorFree = false;
 	this->mem = Memory();
 	//number of holes is null until mem is initialized
 	this->holes = nullptr; 
+	this->trace = nullptr;
+	this->profiler = nullptr;
+	this->largeObjectThreshold = 0;
+	this->maintenanceInterval = 0;
+	this->maintenanceStopping = false;
+	this->freesSinceTrim = 0;
+	this->deferredHead = NO_SEGMENT;
+	this->deferredCount = 0;
+	this->snapshotVersion = 0;
+}
+MemoryManagerBase::MemoryManagerBase(MemoryManagerBase&& other) : MemoryManagerBase(other.wordSize)
+{
+	*this = std::move(other);
 }
-MemoryManager::~MemoryManager()
+MemoryManagerBase& MemoryManagerBase::operator = (MemoryManagerBase&& other)
+{
+	if (this == &other)
+		return *this;
+	//Drop whatever this manager holds, then take over other's arena, metadata, large objects and trace.
+	//other's worker points at other, so it is stopped and restarted here.
+	shutdown();
+	stopTrace();
+	stopProfiling();
+	other.stopMaintenance();
+	this->wordSize = other.wordSize;
+	this->totalWords = other.totalWords;
+	this->bytes = other.bytes;
+	this->allocated = other.allocated;
+	this->metadataOnly = other.metadataOnly;
+	this->interiorFree = other.interiorFree;
+	this->mem = std::move(other.mem);
+	this->holes = other.holes;
+	this->trace = other.trace;
+	this->profiler = other.profiler;
+	this->largeObjectThreshold = other.largeObjectThreshold;
+	this->largeObjects = std::move(other.largeObjects);
+	this->maintenanceInterval = other.maintenanceInterval;
+	this->freesSinceTrim = other.freesSinceTrim;
+	//(nobody may be calling freeDeferred on either manager while it moves)
+	this->deferredNext = std::move(other.deferredNext);
+	this->deferredHead = other.deferredHead.exchange(NO_SEGMENT);
+	this->deferredCount = other.deferredCount.exchange(0);
+	this->deferredBatch = std::move(other.deferredBatch);
+	this->deferredLarge = std::move(other.deferredLarge);
+	this->snapshotVersion = other.snapshotVersion.load();
+
+	//other is left uninitialized (settings kept), so its destructor releases nothing
+	other.bytes = 0;
+	other.totalWords = 0;
+	other.allocated = false;
+	other.mem = Memory();
+	other.holes = nullptr;
+	other.trace = nullptr;
+	other.profiler = nullptr;
+	other.largeObjects.clear();
+	other.deferredNext.clear();
+	other.deferredLarge.clear();
+	if (this->bytes != 0)
+		startMaintenance();
+	return *this;
+}
+MemoryManagerBase::~MemoryManagerBase()
 {
 	//if init, call shutdown
 	if (this->bytes != 0)
 		shutdown();
+	stopTrace();
+	stopProfiling();
 }
-void MemoryManager::initialize(size_t sizeInWords)
+int MemoryManagerBase::initialize(size_t sizeInWords, unsigned prefaultThreads)
 {
+	//Returns 0, or -1 if the arena can't be set up (the manager is then left uninitialized).
 	//No larger than 65536 words
 	if (sizeInWords > 65536)
-		return;
+		return -1;
+	//Hole offsets and sizes are 32-bit byte counts, so an arena (metadata-only too) is at most INT_MAX bytes;
+	//the product is taken in 64 bits so a big word size is refused instead of wrapping
+	if (this->wordSize == 0 || (uint64_t)this->wordSize * sizeInWords > INT_MAX)
+		return -1;
 	//Most of your other functions should not work before this is called.
 	//They should return the relevant error for the data type, such as void, -1, nullptr, etc.
 
@@ -33,507 +104,1114 @@ void MemoryManager::initialize(size_t sizeInWords)
 	//Instantiates contiguous array of size(sizeInWords * wordSize) amount of bytes.
 	this->totalWords = sizeInWords;
 	this->bytes = this->wordSize * this->totalWords;
-	this->mem = Memory(this->bytes);
+	//prefaultThreads > 0 faults every page in now so the first allocations don't pay for it (see prefaultArena)
+	this->mem = Memory(this->bytes, this->wordSize, this->metadataOnly, prefaultThreads);
+	if (!this->mem.getMemStart())
+	{
+		this->bytes = 0;
+		this->totalWords = 0;
+		this->mem = Memory();
+	}
+	if (this->bytes != 0)
+	{
+		//one deferred-free link per word, so queueing never allocates
+		this->deferredNext = vector<atomic<uint32_t>>(this->totalWords);
+		for (unsigned word = 0; word < this->totalWords; word++)
+			this->deferredNext[word].store(NOT_DEFERRED, memory_order_relaxed);
+		this->deferredBatch.reserve(this->totalWords);
+		startMaintenance();
+	}
+	return this->bytes != 0 ? 0 : -1;
 }
-void MemoryManager::shutdown()
+void MemoryManagerBase::reset()
+{
+	//Frees every allocation at once but keeps the arena and all metadata capacity, for reuse with the same size.
+	//Only the live segments are touched, never the whole arena: block contents are left as they are. Large
+	//objects are unmapped one by one, so the cost is O(segments) plus a munmap per large object.
+	if (this->bytes == 0)
+		return;
+	unique_lock<mutex> guard = lockForMaintenance();
+	this->freesSinceTrim++;
+	if (this->trace)
+		for (int start = 0; start >= 0; start = this->mem.getNextSegment(start))
+			if (this->mem.isBlockStart(start))
+				this->trace->recordFree(this->mem.getSegmentSize(start), start);
+	if (this->trace)
+		for (map<void*, size_t>::iterator object = this->largeObjects.begin(); object != this->largeObjects.end(); object++)
+			this->trace->recordFreeLarge(object->second, object->first);
+	beginUpdate();
+	this->mem.reset();
+	endUpdate();
+	releaseLargeObjects();
+	discardDeferred();
+	//every sampled block is gone with them
+	if (this->profiler)
+		this->profiler->clearLive();
+	this->allocated = false;
+}
+void MemoryManagerBase::shutdown()
 {
 	//If mem isn't initialized, dont perform shutdown
 	if (this->bytes == 0)
 		return;
 	//If mem is initialized, clear all data. Free any heap memory, clear any relevant data structures, reset member variables
-	delete [] ((uint8_t*)getMemoryStart());
+	//(the maintenance worker goes first, it must not touch the arena once it's unmapped)
+	stopMaintenance();
+	this->mem.release(this->bytes);
+	releaseLargeObjects();
+	discardDeferred();
+	if (this->profiler)
+		this->profiler->clearLive();
+	vector<atomic<uint32_t>>().swap(this->deferredNext);
 	this->bytes = 0;
 	this->totalWords = 0;
 	this->allocated = false;
 	this->mem = Memory();
 	this->holes = nullptr;
 }
-void* MemoryManager::allocate(size_t sizeInBytes)
+void* MemoryManagerBase::placeBlock(int blockByteOffset, size_t sizeInBytes, int blockBytes, Lifetime hint)
 {
-	//If mem isn't initialized or if memory is full, dont perform allocate
-	if (this->bytes == 0 || !this->mem.getHoleCount())
-		return nullptr;
-
-	//allocated flag should turn to true once the first allocation happens (used in getList())
-	if (!allocated)
-		allocated = true;
+	//Carves a block of blockBytes starting at blockByteOffset out of the hole containing it.
+	//An allocator that picked something other than a big enough hole gets nothing.
+	int holeStart = this->mem.findHole(blockByteOffset);
+	if (holeStart < 0 || blockByteOffset + blockBytes > holeStart + this->mem.getSegmentSize(holeStart))
+		return failAllocation(sizeInBytes, hint);
 
-	int words;
-	if (sizeInBytes % wordSize != 0)
-		words = (sizeInBytes / wordSize) + 1;
-	else
-		words = (sizeInBytes / wordSize);
-
-	//Call algo to figure out where to allocate, convert word offset back to bytes offset
-	int holeByteOffset = this->allocator(words, getList()) * wordSize;
-	//make sure to free memory from getlist call before allocate terminates
-	delete[] this->holes;
+	if (this->trace)
+		this->trace->recordAllocate(sizeInBytes, blockByteOffset, hint);
 
 	//Allocate bytes in contiguous memory array with value of (uint8_t)1 (not necessary but maybe helpful for hole and block identification)
+	//In metadata-only mode there are no backing bytes to mark
 	void* p = getMemoryStart(); 
-	for (int i = holeByteOffset; i < holeByteOffset + sizeInBytes; i++)
-		//indexing has a higher precedence than casting, therefore just use parantheses to solve this problem
-		((uint8_t*)p)[i] = (uint8_t)1;
+	if (!this->mem.isMetadataOnly())
+		for (int i = blockByteOffset; i < blockByteOffset + sizeInBytes; i++)
+			//indexing has a higher precedence than casting, therefore just use parantheses to solve this problem
+			((uint8_t*)p)[i] = (uint8_t)1;
 	
-	//Update block list
-	this->mem.setBlock(holeByteOffset, sizeInBytes, ((uint8_t*)p) + holeByteOffset);
-
-	//Update holes list (holds information in bytes)
-	for (int i = 0; i < this->mem.getHoles().size(); i++)
-	{
-		//If its the hole used for current memory allocation
-		if (holeByteOffset == this->mem.getHoles()[i].getStartBytes())
-		{
-			//if you take up the entire hole (sizeInBytes == hole.sizeBytes)
-			if (sizeInBytes == this->mem.getHoles()[i].getSizeBytes())
-				//delete exisiting hole 
-				this->mem.getHoles().erase(this->mem.getHoles().begin() + i);
-			else
-			{
-				//reduce existing hole: update offset (new offset = old startBytes + sizeInBytes) and shrink size by sizeInBytes 
-				this->mem.getHoles()[i].setStartBytes(this->mem.getHoles()[i].getStartBytes() + sizeInBytes);
-				this->mem.getHoles()[i].setSizeBytes(this->mem.getHoles()[i].getSizeBytes() - sizeInBytes);
-			}
-			break;
-		}
-	}
+	//Update hole and block metadata
+	beginUpdate();
+	this->mem.carveBlock(holeStart, blockByteOffset, blockBytes);
+	endUpdate();
 	
 	//Returns a pointer somewhere in your memory block to the starting location of the newly allocated space.
-	return ((uint8_t*)p) + holeByteOffset;
+	void* block = ((uint8_t*)p) + blockByteOffset;
+	if (this->profiler && this->profiler->shouldSample(sizeInBytes))
+		this->profiler->recordAllocate(block, sizeInBytes);
+	return block;
 }
-void MemoryManager::free(void* address)
+void* MemoryManagerBase::failAllocation(size_t sizeInBytes, Lifetime hint)
+{
+	if (this->trace)
+		this->trace->recordAllocate(sizeInBytes, -1, hint);
+	return nullptr;
+}
+void MemoryManagerBase::free(void* address)
 {
 	//If mem isn't initialized, dont perform free
 	if (this->bytes == 0)
 		return;
+	unique_lock<mutex> guard = lockForMaintenance();
+	//Large objects live outside the arena, check their table first
+	if (!this->largeObjects.empty() && freeLarge(address))
+		return;
 
-	//Change data allocated in block to 0, done with address (not necessary but maybe helpful for hole and block identification)
-	bool leftAdj = false, rightAdj = false; //keep track of adjacent holes 
-	int x = -1, y = -1, blockIndex = -1;
-	for (int i = 0; i < this->mem.getBlockCount(); i++)
-	{
-		//Block found
-		if (this->mem.getBlocks()[i].getStartAddress() == address)
-		{
-			blockIndex = i;
-			x = this->mem.getBlocks()[i].getStartBytes();
-			y = this->mem.getBlocks()[i].getSizeBytes();
-			for (int j = x; j < x + y; j++)
-				((uint8_t*)getMemoryStart())[j] = (uint8_t)0;
-
-			//check weather there are any adjacent holes
-			if (x > 0 && ((uint8_t*)getMemoryStart())[x - 1] == (uint8_t)0)
-				leftAdj = true;
-			if ((x + y) < this->bytes && ((uint8_t*)getMemoryStart())[x + y] == (uint8_t)0)
-				rightAdj = true; 
+	uint8_t* memStart = (uint8_t*)getMemoryStart();
+	if ((uint8_t*)address < memStart || (uint8_t*)address >= memStart + this->bytes)
+		return;
+	releaseAt((uint8_t*)address - memStart);
+}
+bool MemoryManagerBase::releaseAt(int offsetBytes)
+{
+	//Find the block (any address inside it in interior-free mode, otherwise only its start)
+	int x = offsetBytes;
+	if (this->interiorFree)
+		x = this->mem.findBlock(x);
+	else if (!this->mem.isBlockStart(x))
+		x = -1;
+	if (x < 0)
+		return false;
+	int y = this->mem.getSegmentSize(x);
 
-			break;
-		}
-	}
-	
-	//Figure out which hole is to the left/right of current block 
-	int leftHole = -1, rightHole = -1;
-	if (leftAdj || rightAdj)
-	{
-		for (int k = 0; k < this->mem.getHoleCount(); k++)
-		{
-			//In terms of the starting position of the current hole
-			int leftBlockLocation = this->mem.getHoles()[k].getStartBytes() - this->mem.getBlocks()[blockIndex].getSizeBytes();
-			int rightBlockLocation = this->mem.getHoles()[k].getStartBytes() + this->mem.getHoles()[k].getSizeBytes();
-			//use blockLocation with pointer arithmatic???
-			if ((rightHole < 0) && (leftBlockLocation == this->mem.getBlocks()[blockIndex].getStartBytes()))
-				rightHole = k;
-			else if ((leftHole < 0) && (rightBlockLocation == this->mem.getBlocks()[blockIndex].getStartBytes()))
-				leftHole = k;
-		}
-	}
+	//Change data allocated in block to 0 (not necessary but maybe helpful for hole and block identification)
+	uint8_t* memStart = (uint8_t*)getMemoryStart();
+	if (!this->mem.isMetadataOnly())
+		for (int j = x; j < x + y; j++)
+			memStart[j] = (uint8_t)0;
 
-	//case 1: if none, make new hole
-	if (!leftAdj && !rightAdj)
-		this->mem.setHole(x, y, ((uint8_t*)getMemoryStart()) + x);
-	//case 2: if hole left, keep offset and increase left hole size by block size
-	else if (leftAdj && !rightAdj)
+	if (this->profiler)
+		this->profiler->recordFree(memStart + x);
+
+	//Turn the block back into a hole, merging it with the holes either side
+	beginUpdate();
+	this->mem.releaseBlock(x);
+	endUpdate();
+	this->freesSinceTrim++;
+
+	if (this->trace)
+		this->trace->recordFree(y, x);
+	return true;
+}
+void MemoryManagerBase::freeDeferred(void* address)
+{
+	/*
+		free() for threads other than the owner: the block is only queued, nothing in the arena is touched, and no
+		lock is taken. The owner reclaims the queue in batches (allocate once DEFERRED_FREE_BATCH are waiting or when
+		nothing fits, drainDeferred(), or the maintenance worker). The queue is a stack of word offsets linked through
+		deferredNext; the owner takes the whole stack with one exchange, so pushes never race a pop (no ABA).
+		Safe to call concurrently with anything except initialize/shutdown/move.
+	*/
+	if (this->bytes == 0)
+		return;
+	uint8_t* memStart = (uint8_t*)getMemoryStart();
+	if ((uint8_t*)address < memStart || (uint8_t*)address >= memStart + this->bytes)
 	{
-		this->mem.getHoles()[leftHole].setSizeBytes(this->mem.getHoles()[leftHole].getSizeBytes() + this->mem.getBlocks()[blockIndex].getSizeBytes());
+		//not in the arena: a large object (or junk, which the drain ignores like free does); rare, so a plain lock
+		lock_guard<mutex> guard(this->deferredLargeLock);
+		this->deferredCount.fetch_add(1, memory_order_relaxed);
+		this->deferredLarge.push_back(address);
+		return;
 	}
-	//case 3: if hole right, decrease offset by block size and increase right hole size by block size
-	else if (!leftAdj && rightAdj)
+	size_t offset = (uint8_t*)address - memStart;
+	if (!this->interiorFree && offset % this->wordSize != 0)
+		return;
+	uint32_t word = offset / this->wordSize;
+
+	//claim the word's link; if it's already queued this is a repeated free and is dropped
+	uint32_t unqueued = NOT_DEFERRED;
+	if (!this->deferredNext[word].compare_exchange_strong(unqueued, NO_SEGMENT, memory_order_relaxed))
+		return;
+	//counted before the push publishes the word, so a reclaim that takes it never subtracts more than was added
+	this->deferredCount.fetch_add(1, memory_order_relaxed);
+	uint32_t head = this->deferredHead.load(memory_order_relaxed);
+	do
+		this->deferredNext[word].store(head, memory_order_relaxed);
+	while (!this->deferredHead.compare_exchange_weak(head, word, memory_order_release, memory_order_relaxed));
+}
+size_t MemoryManagerBase::drainDeferred()
+{
+	//Reclaims everything queued by freeDeferred now; returns the number of blocks freed
+	if (this->bytes == 0)
+		return 0;
+	unique_lock<mutex> guard = lockForMaintenance();
+	return reclaimDeferred();
+}
+size_t MemoryManagerBase::getDeferredCount()
+{
+	return this->deferredCount.load(memory_order_relaxed);
+}
+size_t MemoryManagerBase::reclaimDeferred()
+{
+	//Owner side (maintenance lock held if there is a worker). Take the whole stack, then free in address order:
+	//each block then merges into the hole the previous one just left, one sweep up the arena.
+	size_t reclaimed = 0;
+	this->deferredBatch.clear();
+	for (uint32_t word = this->deferredHead.exchange(NO_SEGMENT, memory_order_acquire); word != NO_SEGMENT;)
 	{
-		this->mem.getHoles()[rightHole].setStartBytes(this->mem.getBlocks()[blockIndex].getStartBytes());
-		this->mem.getHoles()[rightHole].setSizeBytes(this->mem.getHoles()[rightHole].getSizeBytes() + this->mem.getBlocks()[blockIndex].getSizeBytes());
+		uint32_t next = this->deferredNext[word].load(memory_order_relaxed);
+		this->deferredBatch.push_back(word);
+		this->deferredNext[word].store(NOT_DEFERRED, memory_order_relaxed);
+		word = next;
 	}
-	//case 4: if two adjacent holes: keep left hole offset and increase left hole size by block size + right hole size, delete right hole
-	else if (leftAdj && rightAdj)
+	this->deferredCount.fetch_sub(this->deferredBatch.size(), memory_order_relaxed);
+	sort(this->deferredBatch.begin(), this->deferredBatch.end());
+	for (size_t i = 0; i < this->deferredBatch.size(); i++)
+		reclaimed += releaseAt(this->deferredBatch[i] * this->wordSize);
+
+	lock_guard<mutex> guard(this->deferredLargeLock);
+	for (size_t i = 0; i < this->deferredLarge.size(); i++)
+		reclaimed += freeLarge(this->deferredLarge[i]);
+	this->deferredCount.fetch_sub(this->deferredLarge.size(), memory_order_relaxed);
+	this->deferredLarge.clear();
+	return reclaimed;
+}
+void MemoryManagerBase::discardDeferred()
+{
+	//Forgets queued frees without freeing anything (reset/shutdown have released every block already).
+	//Only what was taken is uncounted: a freeDeferred still pushing has counted its word but not published it
+	size_t discarded = 0;
+	for (uint32_t word = this->deferredHead.exchange(NO_SEGMENT); word != NO_SEGMENT; discarded++)
 	{
-		int newSize = this->mem.getHoles()[leftHole].getSizeBytes() + this->mem.getHoles()[rightHole].getSizeBytes() + this->mem.getBlocks()[blockIndex].getSizeBytes();
-		this->mem.getHoles()[leftHole].setSizeBytes(newSize);
-		this->mem.getHoles().erase(this->mem.getHoles().begin() + rightHole);
+		uint32_t next = this->deferredNext[word].load();
+		this->deferredNext[word].store(NOT_DEFERRED);
+		word = next;
 	}
-
-	//delete block
-	this->mem.getBlocks().erase(this->mem.getBlocks().begin() + blockIndex);
+	lock_guard<mutex> guard(this->deferredLargeLock);
+	this->deferredCount.fetch_sub(discarded + this->deferredLarge.size());
+	this->deferredLarge.clear();
 }
-void* MemoryManager::getList()
+bool MemoryManagerBase::takeSnapshot(MemorySnapshot& snapshot)
 {
-	//If mem isn't initialized or if no memory has been allocated, dont perform getList
-	if (this->bytes == 0 || !this->allocated)
-		return nullptr;
-
-	//offset = (startBytes / wordSize), length = sizeBytes / wordSize
-	//uint16_t* holes dynamically allocates an array of size [Hole object array * 2 + 1] with the information stored in an vector of Hole objects
-	int size = (this->mem.getHoleCount() * 2) + 1;
-	this->holes = new uint16_t[size];
-	this->holes[0] = (uint16_t)this->mem.getHoleCount();
-
-	sort(this->mem.getHoles().begin(), this->mem.getHoles().end());
-	
-	int j = 0;
-	for (int i = 1; i < size; i++)
+	/*
+		Copies the holes for monitoring from any thread, without ever making allocate/free wait: the owner bumps
+		snapshotVersion to odd before changing the holes and back to even after (a seqlock), and the copy is retried
+		until it was taken with no change in between. The copy is O(holes), updates are a few instructions, so a
+		retry is rare even under heavy churn. Not safe against initialize/shutdown/move. false if uninitialized.
+	*/
+	if (this->bytes == 0)
+		return false;
+	snapshot.wordSize = this->wordSize;
+	snapshot.totalWords = this->totalWords;
+	snapshot.starts.resize(this->mem.getHoleCapacity());
+	snapshot.sizes.resize(this->mem.getHoleCapacity());
+	int count;
+	for (;;)
 	{
-		//Odd index elements are always the hole offsets
-		if (i % 2 != 0)
+		uint64_t before = this->snapshotVersion.load(memory_order_acquire);
+		if (before & 1)
 		{
-			uint16_t offset;		
-			if (this->mem.getHoles()[j].getStartBytes() % wordSize != 0)
-				offset = (this->mem.getHoles()[j].getStartBytes() / wordSize) + 1;
-			else
-				offset = this->mem.getHoles()[j].getStartBytes() / wordSize;
-			this->holes[i] = offset;
+			this_thread::yield();
+			continue;
 		}
-		//Even index elements are always the hole lengths
-		else
+		count = this->mem.copyHoles(snapshot.starts.data(), snapshot.sizes.data());
+		atomic_thread_fence(memory_order_acquire);
+		if (this->snapshotVersion.load(memory_order_relaxed) == before)
 		{
-			uint16_t sizeInWords;
-			if (this->mem.getHoles()[j].getSizeBytes() % wordSize != 0)
-				sizeInWords = (this->mem.getHoles()[j].getSizeBytes() / wordSize) + 1;
-			else
-				sizeInWords = this->mem.getHoles()[j].getSizeBytes() / wordSize;
-			this->holes[i] = sizeInWords;
-			j++;
+			snapshot.version = before / 2;
+			break;
 		}
 	}
 
-	return this->holes;
+	//the holes are in no particular order, the snapshot keeps them by address
+	snapshot.holes.clear();
+	snapshot.holes.reserve(this->mem.getHoleCapacity());
+	for (int i = 0; i < count; i++)
+		snapshot.holes.push_back(make_pair(snapshot.starts[i] / this->wordSize, snapshot.sizes[i] / this->wordSize));
+	sort(snapshot.holes.begin(), snapshot.holes.end());
+	return true;
+}
+int MemoryManagerBase::dumpMemoryMapAsync(char* filename, std::function<void(int)> callback)
+{
+	//dumpMemoryMap without the I/O: only the snapshot copy happens here, the shared MemoryMapWriter does the rest and
+	//calls callback(0 or -1) from its thread. -1 right away if uninitialized or too many dumps are already waiting.
+	return MemoryMapWriter::getShared().submit(*this, filename, callback);
 }
-unsigned MemoryManager::getWordSize()
+int MemoryManagerBase::getRunLengthMap(uint8_t* buffer, size_t capacity)
+{
+	/*
+	Occupancy as a run-length map (format in RunLengthMap.h), read off the hole index: each hole is the next one
+	after the previous, O(log n) apiece, so the cost follows the number of holes rather than the arena size.
+	Returns the bytes the map takes; the buffer holds the whole map only if capacity is at least that.
+	-1 if mem isn't initialized.
+	*/
+	if (this->bytes == 0)
+		return -1;
+	unique_lock<mutex> guard = lockForMaintenance();
+	size_t length = 0;
+	putRunLengthValue(buffer, capacity, length, this->totalWords);
+	putRunLengthValue(buffer, capacity, length, this->mem.getHoleCount());
+	HoleIndex& index = this->mem.getHoleIndex();
+	unsigned end = 0;
+	for (int hole = index.firstFit(1); hole >= 0; hole = index.firstFitFrom(end, 1))
+	{
+		putRunLengthValue(buffer, capacity, length, hole - end);
+		putRunLengthValue(buffer, capacity, length, index.getSize(hole));
+		end = hole + index.getSize(hole);
+	}
+	putRunLengthValue(buffer, capacity, length, this->totalWords - end);
+	return length;
+}
+void MemoryManagerBase::beginUpdate()
+{
+	//Writer side of the snapshot seqlock; only the owner (or the maintenance worker, holding its lock) writes
+	uint64_t version = this->snapshotVersion.load(memory_order_relaxed);
+	this->snapshotVersion.store(version + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+void MemoryManagerBase::endUpdate()
+{
+	this->snapshotVersion.store(this->snapshotVersion.load(memory_order_relaxed) + 1, memory_order_release);
+}
+unsigned MemoryManagerBase::getWordSize()
 {
 	//Returns wordSize member variable.
 	return this->wordSize;
 }
-void* MemoryManager::getMemoryStart()
+void* MemoryManagerBase::getMemoryStart()
 {
 	//If mem isn't initialized, dont perform getMemoryStart
 	if (this->bytes == 0)
 		return nullptr;
 
-	//Returns pointer to the start of your contiguous memory array
+	//Returns pointer to the start of your contiguous memory array (an opaque, unreadable base in metadata-only mode)
 	return this->mem.getMemStart();
 }
-unsigned MemoryManager::getMemoryLimit()
+unsigned MemoryManagerBase::getMemoryLimit()
 {
 	//Returns unsigned int(unsigned and unsigned int are the same type) that is the total amount of bytes you can store.
 	return this->bytes;
 }
-void MemoryManager::setAllocator(std::function<int(int, void*)> allocator)
+int MemoryManagerBase::getHoleCount()
 {
-	//Just a setter function.Changes your member variable to the new allocator.
-	this->allocator = allocator;
+	//the maintenance worker reclaims deferred frees, which merges holes, so readers take its lock
+	unique_lock<mutex> guard = lockForMaintenance();
+	return this->mem.getHoleCount();
 }
-int MemoryManager::dumpMemoryMap(char* filename)
-{ 
-	/*
-	Prints out current list of holes to a file. You must use POSIX calls, you cannot use fstream objects.
-	Use open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777) to create, enable read-write, and truncate
-	the file on creation. Remember to call close on the file descriptor before ending the function, or
-	your changes may not save.
-	*/
-	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
-
-	//Error opening file
-	if (fd == -1)
-		return -1;
-	
-	//Write data to file (temp.front().c_str(), strlen(temp.front().c_str()))
-	getList();
-	int length = this->holes[0] * 2;
-	string data = "";
-	data += "[" + to_string(this->holes[1]) + ", " + to_string(this->holes[2]);
-	for (int i = 3; i < length; i += 2)
-	{
-		data += "] - [" + to_string(this->holes[i]) + ", " + to_string(this->holes[i + 1]);
-	}
-	//delete dynamic Holes array
-	delete[] this->holes;
-	data += "]";
-	size_t bytesWritten = write(fd, data.c_str(), strlen(data.c_str()));
-	
-	//Error writing to file
-	if (bytesWritten == -1)
+int MemoryManagerBase::getHoleStartBytes(int index)
+{
+	unique_lock<mutex> guard = lockForMaintenance();
+	return this->mem.getHoleStart(index);
+}
+int MemoryManagerBase::getHoleSizeBytes(int index)
+{
+	unique_lock<mutex> guard = lockForMaintenance();
+	return this->mem.getHoleSize(index);
+}
+int MemoryManagerBase::getHoleCountUnlocked()
+{
+	return this->mem.getHoleCount();
+}
+const uint32_t* MemoryManagerBase::getHoleStarts()
+{
+	//all hole starts in bytes, contiguous (index i matches getHoleSizes()[i])
+	return this->mem.getHoleStarts();
+}
+const uint32_t* MemoryManagerBase::getHoleSizes()
+{
+	return this->mem.getHoleSizes();
+}
+HoleIndex& MemoryManagerBase::getHoleIndex()
+{
+	return this->mem.getHoleIndex();
+}
+int MemoryManagerBase::startTrace(char* filename)
+{
+	//Logs every allocate/free call to a binary trace file until stopTrace() (see AllocationTrace.h)
+	stopTrace();
+	TraceRecorder* recorder = new TraceRecorder();
+	if (recorder->open(filename, this->wordSize, this->totalWords) == -1)
 	{
-		close(fd);
+		delete recorder;
 		return -1;
 	}
-	
-	//close the file (-1 if error closing file)
-	if (close(fd) == -1)
-		return -1;
-
+	//the maintenance worker records the deferred frees it reclaims, so the trace only changes under its lock
+	unique_lock<mutex> guard = lockForMaintenance();
+	this->trace = recorder;
 	return 0;
 }
-void* MemoryManager::getBitmap()
+void MemoryManagerBase::setMetadataOnly(bool metadataOnly)
+{
+	//Takes effect on the next initialize(). In metadata-only mode only the hole and block lists are kept,
+	//no backing bytes are allocated, and allocate returns opaque handles that free accepts.
+	//The address range is still reserved (PROT_NONE, never committed) so handles are unique and fault if used.
+	//The limits are the same as a real arena: 65536 words and INT_MAX bytes of address space, and the metadata
+	//still takes a few dozen bytes per word (not per block), whatever the word size: this mode saves the backing
+	//bytes, it doesn't make terabyte-scale heaps possible.
+	this->metadataOnly = metadataOnly;
+}
+bool MemoryManagerBase::isMetadataOnly()
 {
-	//use shifting, bitOR, bitAND (<<, |, &) 
+	return this->metadataOnly;
+}
+void MemoryManagerBase::setLargeObjectThreshold(size_t sizeInBytes)
+{
+	//Requests of at least sizeInBytes are mapped on their own instead of carved out of the arena (0 turns this off).
+	//They don't show up in the hole list, bitmap or memory map; traces record them with their own ops.
+	this->largeObjectThreshold = sizeInBytes;
+}
+size_t MemoryManagerBase::getLargeObjectThreshold()
+{
+	return this->largeObjectThreshold;
+}
+size_t MemoryManagerBase::getLargeObjectCount()
+{
+	unique_lock<mutex> guard = lockForMaintenance();
+	return this->largeObjects.size();
+}
+bool MemoryManagerBase::isLargeObject(size_t sizeInBytes)
+{
+	return this->largeObjectThreshold && sizeInBytes >= this->largeObjectThreshold;
+}
+void* MemoryManagerBase::allocateLarge(size_t sizeInBytes, Lifetime hint)
+{
+	//Same opaque, unreadable handles as the arena in metadata-only mode
+	int protection = this->metadataOnly ? PROT_NONE : PROT_READ | PROT_WRITE;
+	void* p = mmap(nullptr, sizeInBytes, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (this->trace)
+		this->trace->recordAllocateLarge(sizeInBytes, p == MAP_FAILED ? nullptr : p, hint);
+	if (p == MAP_FAILED)
+		return nullptr;
+	this->largeObjects[p] = sizeInBytes;
+	if (this->profiler && this->profiler->shouldSample(sizeInBytes))
+		this->profiler->recordAllocate(p, sizeInBytes);
+	return p;
+}
+map<void*, size_t>::iterator MemoryManagerBase::findLarge(void* address)
+{
+	//last mapping starting at or before address, if address is inside it
+	map<void*, size_t>::iterator object = this->largeObjects.upper_bound(address);
+	if (object == this->largeObjects.begin())
+		return this->largeObjects.end();
+	object--;
+	if ((uint8_t*)address >= (uint8_t*)object->first + object->second)
+		return this->largeObjects.end();
+	return object;
+}
+bool MemoryManagerBase::freeLarge(void* address)
+{
+	map<void*, size_t>::iterator object = findLarge(address);
+	if (object == this->largeObjects.end() || (!this->interiorFree && object->first != address))
+		return false;
+	if (this->profiler)
+		this->profiler->recordFree(object->first);
+	if (this->trace)
+		this->trace->recordFreeLarge(object->second, object->first);
+	munmap(object->first, object->second);
+	this->largeObjects.erase(object);
+	return true;
+}
+bool MemoryManagerBase::owns(void* address)
+{
+	return findBlock(address).start != nullptr;
+}
+BlockInfo MemoryManagerBase::findBlock(void* address)
+{
+	//Allocated block (arena block or large object) containing address, in O(log n). sizeBytes is the block's
+	//size in the arena, i.e. the request rounded up to whole words.
+	BlockInfo info = { nullptr, 0 };
+	if (this->bytes == 0)
+		return info;
+	unique_lock<mutex> guard = lockForMaintenance();
 
-	string wordStream = "";
-	int byteCountBlock = 0, byteCountHole = 0, words = 0, byteSpace = 0;
-	//Converts memory bitstream into wordstream (8-bit intervals) 
-	for (int i = 0; i < bytes; i++)
+	uint8_t* memStart = (uint8_t*)getMemoryStart();
+	if ((uint8_t*)address >= memStart && (uint8_t*)address < memStart + this->bytes)
 	{
-		//If block
-		if (unsigned(((uint8_t*)getMemoryStart())[i]))
+		int start = this->mem.findBlock((uint8_t*)address - memStart);
+		if (start >= 0)
 		{
-			//convert hole to words
-			if (byteCountHole)
-			{
-				if (byteCountHole % wordSize != 0)
-					words = (byteCountHole / wordSize) + 1;
-				else
-					words = (byteCountHole / wordSize);
-
-				for (int j = 0; j < words; j++)
-				{
-					if (byteSpace != 0 && byteSpace % 8 == 0)
-						byteSpace = 0;
-
-					wordStream += "0";
-					byteSpace++;
-				}
-
-				byteCountHole = 0;
-			}
-
-			byteCountBlock++;
-		}
-		//If hole
-		else
-		{
-			//convert block to words
-			if (byteCountBlock)
-			{
-				if (byteCountBlock % wordSize != 0)
-					words = (byteCountBlock / wordSize) + 1;
-				else
-					words = (byteCountBlock / wordSize);
-
-				for (int j = 0; j < words; j++)
-				{
-					if (byteSpace != 0 && byteSpace % 8 == 0)
-						byteSpace = 0;
-
-					wordStream += "1";
-					byteSpace++;
-				}
-
-				byteCountBlock = 0;
-			}
-
-			byteCountHole++;
+			info.start = memStart + start;
+			info.sizeBytes = this->mem.getSegmentSize(start);
 		}
+		return info;
 	}
 
-	//Accounts for last block/hole (skipped over because loop ends)
-	if (byteCountBlock)
+	map<void*, size_t>::iterator object = findLarge(address);
+	if (object != this->largeObjects.end())
 	{
-		if (byteCountBlock % wordSize != 0)
-			words = (byteCountBlock / wordSize) + 1;
-		else
-			words = (byteCountBlock / wordSize);
-
-		for (int j = 0; j < words; j++)
-		{
-			if (byteSpace != 0 && byteSpace % 8 == 0)
-				byteSpace = 0;
-
-			wordStream += "1";
-			byteSpace++;
-		}
-
-		byteCountBlock = 0;
+		info.start = object->first;
+		info.sizeBytes = object->second;
 	}
-	else
+	return info;
+}
+void MemoryManagerBase::setInteriorFree(bool interiorFree)
+{
+	//Opt-in: free() accepts any pointer into a block, not just the one allocate returned.
+	//Not while other threads call freeDeferred; the maintenance worker reads it under its lock.
+	unique_lock<mutex> guard = lockForMaintenance();
+	this->interiorFree = interiorFree;
+}
+bool MemoryManagerBase::isInteriorFree()
+{
+	return this->interiorFree;
+}
+void MemoryManagerBase::releaseLargeObjects()
+{
+	//only unmaps: reset/shutdown record the frees and clear the profiler's live samples themselves
+	for (map<void*, size_t>::iterator object = this->largeObjects.begin(); object != this->largeObjects.end(); object++)
+		munmap(object->first, object->second);
+	this->largeObjects.clear();
+}
+void MemoryManagerBase::setMaintenanceInterval(unsigned milliseconds)
+{
+	/*
+		Takes effect on the next initialize(): every `milliseconds` a background thread reclaims deferred frees and
+		returns the whole pages inside holes to the OS (madvise, they come back zero-filled on the next touch), so
+		allocate/free never trim themselves.
+		While the worker runs, allocate/free/reset and the worker take turns on one lock. 0 turns it off.
+	*/
+	//(a running worker reads the interval between passes)
+	unique_lock<mutex> guard = lockForMaintenance();
+	this->maintenanceInterval = milliseconds;
+}
+unsigned MemoryManagerBase::getMaintenanceInterval()
+{
+	return this->maintenanceInterval;
+}
+size_t MemoryManagerBase::maintain()
+{
+	//One maintenance pass right now, on the calling thread; returns the bytes handed back to the OS
+	if (this->bytes == 0)
+		return 0;
+	lock_guard<mutex> guard(this->maintenanceLock);
+	reclaimDeferred();
+	return trimHoles();
+}
+unique_lock<mutex> MemoryManagerBase::lockForMaintenance()
+{
+	//The worker only exists between initialize() and shutdown(), which the owning thread calls, so without one
+	//allocate/free take no lock at all
+	if (!this->maintainer.joinable())
+		return unique_lock<mutex>();
+	return unique_lock<mutex>(this->maintenanceLock);
+}
+void MemoryManagerBase::startMaintenance()
+{
+	if (this->maintenanceInterval == 0 || this->maintainer.joinable())
+		return;
+	this->maintenanceStopping = false;
+	this->maintainer = thread(&MemoryManagerBase::maintenanceLoop, this);
+}
+void MemoryManagerBase::stopMaintenance()
+{
+	if (!this->maintainer.joinable())
+		return;
 	{
-		if (byteCountHole % wordSize != 0)
-			words = (byteCountHole / wordSize) + 1;
-		else
-			words = (byteCountHole / wordSize);
-
-		for (int j = 0; j < words; j++)
-		{
-			if (byteSpace != 0 && byteSpace % 8 == 0)
-				byteSpace = 0;
-
-			wordStream += "0";
-			byteSpace++;
-		}
-
-		byteCountHole = 0;
+		lock_guard<mutex> guard(this->maintenanceLock);
+		this->maintenanceStopping = true;
 	}
-
-	//Covers the rest of the byte with 0's 
-	while (byteSpace < 8)
+	this->maintenanceWake.notify_all();
+	this->maintainer.join();
+}
+void MemoryManagerBase::maintenanceLoop()
+{
+	//Sleeps with the lock released, so the foreground only waits while a pass actually runs
+	unique_lock<mutex> guard(this->maintenanceLock);
+	while (!this->maintenanceWake.wait_for(guard, chrono::milliseconds(this->maintenanceInterval), [this]() { return this->maintenanceStopping; }))
 	{
-		wordStream += "0";
-		byteSpace++;
+		reclaimDeferred();
+		trimHoles();
 	}
+}
+size_t MemoryManagerBase::trimHoles()
+{
+	//Caller holds maintenanceLock. Only frees make new free pages, so a pass without frees since the last one is skipped.
+	if (this->mem.isMetadataOnly() || this->freesSinceTrim == 0)
+		return 0;
+	this->freesSinceTrim = 0;
 
-	//Mirror each individual wordstream byte
-	string mirror = "";
-	while (byteSpace <= wordStream.size())
+	//nobody may read a hole, so dropping its pages (they come back zero-filled) changes nothing a caller could see;
+	//the arena is page aligned, so only pages entirely inside a hole go
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	uint8_t* memStart = (uint8_t*)getMemoryStart();
+	size_t released = 0;
+	for (int i = 0; i < this->mem.getHoleCount(); i++)
 	{
-		byteSpace--;
-		mirror += wordStream[byteSpace];
-		if (byteSpace % 8 == 0)
-		{
-			byteSpace += 16;
-		}
+		size_t first = (this->mem.getHoleStart(i) + pageSize - 1) / pageSize * pageSize;
+		size_t last = (size_t)(this->mem.getHoleStart(i) + this->mem.getHoleSize(i)) / pageSize * pageSize;
+		if (last > first && madvise(memStart + first, last - first, MADV_DONTNEED) == 0)
+			released += last - first;
 	}
+	return released;
+}
+void MemoryManagerBase::startProfiling(size_t sampleIntervalBytes)
+{
+	//Samples about one allocation per sampleIntervalBytes allocated (1 = every allocation) with its call stack, until
+	//stopProfiling(); writeHeapProfile() writes the sampled live bytes per call stack for pprof (see HeapProfiler.h)
+	stopProfiling();
+	HeapProfiler* created = new HeapProfiler(sampleIntervalBytes);
+	//the maintenance worker reports the deferred frees it reclaims, so the profiler is only touched under its lock
+	unique_lock<mutex> guard = lockForMaintenance();
+	this->profiler = created;
+}
+void MemoryManagerBase::stopProfiling()
+{
+	unique_lock<mutex> guard = lockForMaintenance();
+	delete this->profiler;
+	this->profiler = nullptr;
+}
+int MemoryManagerBase::writeHeapProfile(char* filename)
+{
+	unique_lock<mutex> guard = lockForMaintenance();
+	if (!this->profiler)
+		return -1;
+	return this->profiler->write(filename);
+}
+size_t MemoryManagerBase::getProfiledCount()
+{
+	//sampled allocations that are still live
+	unique_lock<mutex> guard = lockForMaintenance();
+	return this->profiler ? this->profiler->getLiveSampleCount() : 0;
+}
+void MemoryManagerBase::stopTrace()
+{
+	//Flushes and closes the trace file, if one is being recorded
+	unique_lock<mutex> guard = lockForMaintenance();
+	if (!this->trace)
+		return;
+	this->trace->close();
+	delete this->trace;
+	this->trace = nullptr;
+}
 
-	//Add two size bytes to the front
-	string wordStreamSizeBits = bitset<16>(wordStream.size() / 8).to_string();
-	//cout << wordStreamSizeBits;
-
-	//TODO: flip wordStreamSizeBits for little-Endian and push it to front of mirror 
-	string littleEnd1 = "", littleEnd2 = "";
-	for (int i = 0; i < wordStreamSizeBits.size(); i++)
-	{
-		if (i < 8)
-			littleEnd2 += wordStreamSizeBits[i];
-		else
-			littleEnd1 += wordStreamSizeBits[i];
-	}
+//MemoryManager (runtime-configurable instantiation) functions
+MemoryManager::MemoryManager(unsigned wordSize, std::function<int(int, void*)> allocator) : BasicMemoryManager(wordSize, CallbackPolicy(allocator))
+{
 
-	string bitMap = littleEnd1 + littleEnd2 + mirror;
+}
+void MemoryManager::setAllocator(std::function<int(int, void*)> allocator)
+{
+	//Just a setter function.Changes your member variable to the new allocator.
+	this->policy = CallbackPolicy(allocator);
+}
 
-	int size = (wordStream.size() / 8) + 2;
-	uint8_t* bitWordMap = new uint8_t[size];
+//Callback policy functions
+CallbackPolicy::CallbackPolicy(std::function<int(int, void*)> allocator)
+{
+	this->allocator = allocator;
+	//recognised once here so place() doesn't have to inspect the std::function on every call
+	int (*const* function)(int, void*) = allocator.target<int(*)(int, void*)>();
+	this->builtin = CALLBACK_CUSTOM;
+	if (function && *function == firstFit)
+		this->builtin = CALLBACK_FIRST_FIT;
+	else if (function && *function == bestFit)
+		this->builtin = CALLBACK_BEST_FIT;
+	else if (function && *function == worstFit)
+		this->builtin = CALLBACK_WORST_FIT;
+}
 
-	int index = 0;
-	for (int i = 0; i < size; i++)
+//MemorySnapshot class functions
+MemorySnapshot::MemorySnapshot()
+{
+	this->version = 0;
+	this->wordSize = 0;
+	this->totalWords = 0;
+}
+uint64_t MemorySnapshot::getVersion()
+{
+	return this->version;
+}
+int MemorySnapshot::getHoleCount()
+{
+	return this->holes.size();
+}
+int MemorySnapshot::getList(uint16_t* buffer, size_t capacity)
+{
+	//[count, offset, length, ...] in words like MemoryManager::getList; returns the length the list needs
+	int length = (this->holes.size() * 2) + 1;
+	if (capacity < (size_t)length)
+		return length;
+	buffer[0] = (uint16_t)this->holes.size();
+	for (size_t j = 0; j < this->holes.size(); j++)
 	{
-		string temp = bitMap.substr(index, 8);
-		bitWordMap[i] = (uint8_t)stoi(temp, nullptr, 2);
-		index += 8;
+		buffer[(2 * j) + 1] = (uint16_t)this->holes[j].first;
+		buffer[(2 * j) + 2] = (uint16_t)this->holes[j].second;
 	}
-
+	return length;
+}
+void* MemorySnapshot::getBitmap()
+{
+	//Same layout as MemoryManager::getBitmap: two little-endian size bytes, then one bit per word, 1 = block
+	if (this->totalWords == 0)
+		return nullptr;
+	int mapBytes = (this->totalWords + 7) / 8;
+	uint8_t* bitWordMap = new uint8_t[mapBytes + 2];
+	bitWordMap[0] = (uint8_t)(mapBytes & 0xFF);
+	bitWordMap[1] = (uint8_t)(mapBytes >> 8);
+	uint8_t* map = bitWordMap + 2;
+	memset(map, 0xFF, mapBytes);
+	if (this->totalWords % 8 != 0)
+		map[mapBytes - 1] = (uint8_t)((1 << (this->totalWords % 8)) - 1);
+	for (size_t i = 0; i < this->holes.size(); i++)
+		for (uint32_t w = this->holes[i].first; w < this->holes[i].first + this->holes[i].second && w < this->totalWords; w++)
+			map[w >> 3] &= (uint8_t)~(1 << (w & 7));
 	return bitWordMap;
 }
+int MemorySnapshot::getRunLengthMap(uint8_t* buffer, size_t capacity)
+{
+	//Same map as MemoryManagerBase::getRunLengthMap, from the copied holes
+	size_t length = 0;
+	putRunLengthValue(buffer, capacity, length, this->totalWords);
+	putRunLengthValue(buffer, capacity, length, this->holes.size());
+	uint32_t end = 0;
+	for (size_t i = 0; i < this->holes.size(); i++)
+	{
+		putRunLengthValue(buffer, capacity, length, this->holes[i].first - end);
+		putRunLengthValue(buffer, capacity, length, this->holes[i].second);
+		end = this->holes[i].first + this->holes[i].second;
+	}
+	putRunLengthValue(buffer, capacity, length, this->totalWords - end);
+	return length;
+}
+int MemorySnapshot::dumpMemoryMap(char* filename)
+{
+	//"[offset, length] - [offset, length]..." like MemoryManager::dumpMemoryMap, with POSIX calls
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
+	if (fd == -1)
+		return -1;
+	string data = "";
+	for (size_t i = 0; i < this->holes.size(); i++)
+		data += (i ? "] - [" : "[") + to_string(this->holes[i].first) + ", " + to_string(this->holes[i].second);
+	if (!this->holes.empty())
+		data += "]";
+	if (write(fd, data.c_str(), data.size()) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	if (close(fd) == -1)
+		return -1;
+	return 0;
+}
 
-//Hole class functions (nested within Memory)
-MemoryManager::Memory::Hole::Hole()
+//Memory class functions
+static void prefaultArena(uint8_t* arena, size_t bytes, unsigned threads)
+{
+	//Write one byte per page so every page is backed (a read would only map the shared zero page).
+	//Each thread takes a contiguous stripe of pages; the kernel handles faults on different pages in parallel.
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t pages = (bytes + pageSize - 1) / pageSize;
+	if (threads > pages)
+		threads = pages;
+	vector<thread> workers;
+	for (unsigned t = 0; t < threads; t++)
+		workers.push_back(thread([arena, pageSize, pages, threads, t]()
+		{
+			for (size_t page = pages * t / threads; page < pages * (t + 1) / threads; page++)
+				((volatile uint8_t*)arena)[page * pageSize] = 0;
+		}));
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+MemoryManagerBase::Memory::Memory()
 {
+	this->wordSize = 1;
+	this->wordShift = 0;
+	this->dynMemory = nullptr;
+	this->metadataOnly = false;
+	this->holeCount = 0;
+	this->blockCount = 0;
+}
+MemoryManagerBase::Memory::Memory(size_t bytes, unsigned wordSize, bool metadataOnly, unsigned prefaultThreads)
+{
+	this->wordSize = wordSize;
+	this->wordShift = -1;
+	for (int shift = 0; shift < 32; shift++)
+		if ((1u << shift) == wordSize)
+			this->wordShift = shift;
+	this->metadataOnly = metadataOnly;
+	if (metadataOnly)
+	{
+		//Reserve address space only (PROT_NONE, nothing is ever committed): handles stay unique per manager
+		//and fault if someone dereferences them
+		void* reserved = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		this->dynMemory = (reserved == MAP_FAILED) ? nullptr : (uint8_t*)reserved;
+	}
+	else
+	{
+		//Arenas are mapped directly (zero-filled, page aligned) so shutdown hands the pages straight back to the OS.
+		//One prefault thread lets the kernel populate the mapping itself, more touch it in parallel stripes.
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | (prefaultThreads == 1 ? MAP_POPULATE : 0);
+		void* arena = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+		this->dynMemory = (arena == MAP_FAILED) ? nullptr : (uint8_t*)arena;
+		if (this->dynMemory && prefaultThreads > 1)
+			prefaultArena(this->dynMemory, bytes, prefaultThreads);
+	}
 
+	//Every piece of metadata is sized for the worst case up front: at most one segment per word,
+	//and holes never touch, so at most one hole per two words
+	int words = toWords((int)bytes);
+	this->segmentWords.assign(words, 0);
+	this->nextSegment.assign(words, NO_SEGMENT);
+	this->prevSegment.assign(words, NO_SEGMENT);
+	this->holeSlot.assign(words, NO_SEGMENT);
+	this->holeStarts.assign((words / 2) + 1, 0);
+	this->holeSizes.assign((words / 2) + 1, 0);
+	this->holeCount = 0;
+	this->blockCount = 0;
+	this->holeIndex.reset(words);
+	this->blockIndex.reset(words);
+
+	//one hole covering the whole arena
+	this->segmentWords[0] = words;
+	addHole(0, words);
 }
-MemoryManager::Memory::Hole::Hole(int startBytes, int sizeBytes, uint8_t* addy)
+void MemoryManagerBase::Memory::release(size_t bytes)
 {
-	this->startBytes = startBytes;
-	this->sizeBytes = sizeBytes;
-	this->address = addy;
+	if (this->dynMemory)
+		munmap(this->dynMemory, bytes);
+	this->dynMemory = nullptr;
 }
-bool MemoryManager::Memory::Hole::operator < (const Hole& h) const
+void* MemoryManagerBase::Memory::getMemStart()
 {
-	return (this->startBytes < h.startBytes);
+	return this->dynMemory;
 }
-int MemoryManager::Memory::Hole::getStartBytes()
+bool MemoryManagerBase::Memory::isMetadataOnly()
 {
-	return this->startBytes;
+	return this->metadataOnly;
 }
-int MemoryManager::Memory::Hole::getSizeBytes()
+int MemoryManagerBase::Memory::getHoleCount()
 {
-	return this->sizeBytes;
+	return this->holeCount;
 }
-void MemoryManager::Memory::Hole::setStartBytes(int newStartBytes)
+int MemoryManagerBase::Memory::getBlockCount()
 {
-	this->startBytes = newStartBytes;
+	return this->blockCount;
 }
-void MemoryManager::Memory::Hole::setSizeBytes(int newSizeBytes)
+int MemoryManagerBase::Memory::getHoleStart(int index)
 {
-	this->sizeBytes = newSizeBytes;
+	return this->holeStarts[index];
 }
-uint8_t* MemoryManager::Memory::Hole::getStartAddress()
+int MemoryManagerBase::Memory::getHoleSize(int index)
 {
-	return this->address;
+	return this->holeSizes[index];
 }
-
-//Block class functions (nested within Memory)
-MemoryManager::Memory::Block::Block()
+const uint32_t* MemoryManagerBase::Memory::getHoleStarts()
 {
-
+	return this->holeStarts.data();
+}
+const uint32_t* MemoryManagerBase::Memory::getHoleSizes()
+{
+	return this->holeSizes.data();
+}
+int MemoryManagerBase::Memory::copyHoles(uint32_t* starts, uint32_t* sizes)
+{
+	//Reader side of takeSnapshot(), may run on another thread while the owner updates the holes: every load is
+	//atomic, and the caller throws the copy away unless the snapshot version says nothing changed meanwhile
+	uint32_t count = __atomic_load_n(&this->holeCount, __ATOMIC_RELAXED);
+	if (count > this->holeStarts.size())
+		count = this->holeStarts.size();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		starts[i] = __atomic_load_n(&this->holeStarts[i], __ATOMIC_RELAXED);
+		sizes[i] = __atomic_load_n(&this->holeSizes[i], __ATOMIC_RELAXED);
+	}
+	return count;
+}
+int MemoryManagerBase::Memory::getHoleCapacity()
+{
+	return this->holeStarts.size();
 }
-MemoryManager::Memory::Block::Block(int startBytes, int sizeBytes, uint8_t* addy)
+HoleIndex& MemoryManagerBase::Memory::getHoleIndex()
 {
-	this->startBytes = startBytes;
-	this->sizeBytes = sizeBytes;
-	this->address = addy;
+	return this->holeIndex;
 }
-int MemoryManager::Memory::Block::getStartBytes()
+int MemoryManagerBase::Memory::getFirstHole()
 {
-	return this->startBytes;
+	//Start (bytes) of the lowest-addressed hole, -1 if there is none; the first segment always starts at word 0
+	if (this->segmentWords.empty())
+		return -1;
+	if (this->holeSlot[0] != NO_SEGMENT)
+		return 0;
+	return getNextHole(0);
 }
-int MemoryManager::Memory::Block::getSizeBytes()
+int MemoryManagerBase::Memory::getNextHole(int holeStartBytes)
 {
-	return this->sizeBytes;
+	//Next hole in address order after the segment starting at holeStartBytes, -1 at the end
+	uint32_t word = this->nextSegment[toWords(holeStartBytes)];
+	while (word != NO_SEGMENT && this->holeSlot[word] == NO_SEGMENT)
+		word = this->nextSegment[word];
+	return word == NO_SEGMENT ? -1 : toBytes(word);
 }
-void MemoryManager::Memory::Block::setStartBytes(int newStartBytes)
+int MemoryManagerBase::Memory::getNextSegment(int startBytes)
 {
-	this->startBytes = newStartBytes;
+	//Next segment (hole or block) in address order, -1 at the end
+	uint32_t word = this->nextSegment[toWords(startBytes)];
+	return word == NO_SEGMENT ? -1 : toBytes(word);
+}
+int MemoryManagerBase::Memory::getSegmentSize(int startBytes)
+{
+	return toBytes(this->segmentWords[toWords(startBytes)]);
+}
+int MemoryManagerBase::Memory::findHole(int offsetBytes)
+{
+	//Start of the hole containing offsetBytes, or -1. Allocations nearly always start at a hole's first word.
+	int word = toWords(offsetBytes);
+	if (word >= (int)this->holeSlot.size())
+		return -1;
+	if (this->holeSlot[word] == NO_SEGMENT)
+		word = this->holeIndex.lastHoleBefore(word + 1);
+	if (word < 0 || toWords(offsetBytes) >= word + (int)this->segmentWords[word])
+		return -1;
+	return toBytes(word);
 }
-void MemoryManager::Memory::Block::setSizeBytes(int newSizeBytes)
+int MemoryManagerBase::Memory::findBlock(int offsetBytes)
 {
-	this->sizeBytes = newSizeBytes;
+	//Start of the block containing offsetBytes (any byte in it), or -1
+	int word = toWords(offsetBytes);
+	if (word >= (int)this->segmentWords.size())
+		return -1;
+	int start = this->blockIndex.lastHoleBefore(word + 1);
+	if (start < 0 || word >= start + (int)this->segmentWords[start])
+		return -1;
+	return toBytes(start);
 }
-uint8_t* MemoryManager::Memory::Block::getStartAddress()
+bool MemoryManagerBase::Memory::isBlockStart(int offsetBytes)
 {
-	return this->address;
+	int word = toWords(offsetBytes);
+	return toBytes(word) == offsetBytes && word < (int)this->segmentWords.size()
+		&& this->segmentWords[word] != 0 && this->holeSlot[word] == NO_SEGMENT;
 }
+void MemoryManagerBase::Memory::carveBlock(int holeStartBytes, int blockStartBytes, int blockBytes)
+{
+	uint32_t hole = toWords(holeStartBytes), block = toWords(blockStartBytes), words = toWords(blockBytes);
+	//an empty block would be linked after itself; allocate never asks for one
+	if (words == 0)
+		return;
+	uint32_t holeEnd = hole + this->segmentWords[hole];
+	uint32_t front = block - hole, back = holeEnd - (block + words);
 
-//Memory class functions
-MemoryManager::Memory::Memory()
+	//if you take up the entire hole, the hole node becomes the block
+	if (front == 0 && back == 0)
+		removeHole(hole);
+	//block at the start of the hole (the usual case): move the hole's offset up and shrink it
+	else if (front == 0)
+	{
+		this->segmentWords[block] = words;
+		linkAfter(block, block + words, back);
+		moveHole(hole, block + words, back);
+	}
+	//block at the end of the hole (long-lived placement): just shrink it
+	else if (back == 0)
+	{
+		this->segmentWords[hole] = front;
+		resizeHole(hole, front);
+		linkAfter(hole, block, words);
+	}
+	//block in the middle: split the hole in two
+	else
+	{
+		this->segmentWords[hole] = front;
+		resizeHole(hole, front);
+		linkAfter(hole, block, words);
+		linkAfter(block, block + words, back);
+		addHole(block + words, back);
+	}
+
+	this->blockIndex.set(block, words);
+	this->blockCount++;
+}
+void MemoryManagerBase::Memory::releaseBlock(int blockStartBytes)
 {
+	uint32_t block = toWords(blockStartBytes), words = this->segmentWords[block];
+	this->blockIndex.remove(block);
+	this->blockCount--;
 
+	//The segments either side are the only holes that can touch the block (block contents may be zero too)
+	uint32_t left = this->prevSegment[block], right = this->nextSegment[block];
+	bool leftAdj = left != NO_SEGMENT && this->holeSlot[left] != NO_SEGMENT;
+	bool rightAdj = right != NO_SEGMENT && this->holeSlot[right] != NO_SEGMENT; //keep track of adjacent holes 
+
+	//case 1: if none, the block node becomes a hole
+	if (!leftAdj && !rightAdj)
+		addHole(block, words);
+	//case 2: if hole left, keep offset and increase left hole size by block size
+	else if (leftAdj && !rightAdj)
+	{
+		unlink(block);
+		this->segmentWords[left] += words;
+		resizeHole(left, this->segmentWords[left]);
+	}
+	//case 3: if hole right, decrease offset by block size and increase right hole size by block size
+	else if (!leftAdj && rightAdj)
+	{
+		uint32_t size = words + this->segmentWords[right];
+		unlink(right);
+		this->segmentWords[block] = size;
+		moveHole(right, block, size);
+	}
+	//case 4: if two adjacent holes: keep left hole offset and increase left hole size by block size + right hole size, delete right hole
+	else
+	{
+		this->segmentWords[left] += words + this->segmentWords[right];
+		removeHole(right);
+		unlink(right);
+		unlink(block);
+		resizeHole(left, this->segmentWords[left]);
+	}
+}
+void MemoryManagerBase::Memory::reset()
+{
+	//Back to one hole covering the arena. Nodes that don't start a segment are always blank, so clearing the
+	//live segments (and their tree leaves) is enough: the cost is the number of segments, not the arena size
+	uint32_t words = this->segmentWords.size();
+	if (words == 0)
+		return;
+	for (uint32_t word = 0; word != NO_SEGMENT;)
+	{
+		uint32_t next = this->nextSegment[word];
+		if (this->holeSlot[word] != NO_SEGMENT)
+			this->holeIndex.remove(word);
+		else
+			this->blockIndex.remove(word);
+		this->segmentWords[word] = 0;
+		this->nextSegment[word] = NO_SEGMENT;
+		this->prevSegment[word] = NO_SEGMENT;
+		this->holeSlot[word] = NO_SEGMENT;
+		word = next;
+	}
+	publish(this->holeCount, 0);
+	this->blockCount = 0;
+
+	this->segmentWords[0] = words;
+	addHole(0, words);
 }
-MemoryManager::Memory::Memory(int bytes)
+int MemoryManagerBase::Memory::toWords(int bytes)
 {
-	this->dynMemory = new uint8_t[bytes]();
-	this->currHoles = vector<Hole>(1, Hole(0, bytes, dynMemory));
-	this->currBlocks = vector<Block>();
+	//holes are word aligned, so this is exact; a shift for power-of-two word sizes
+	if (this->wordShift >= 0)
+		return bytes >> this->wordShift;
+	return bytes / this->wordSize;
 }
-void* MemoryManager::Memory::getMemStart()
+int MemoryManagerBase::Memory::toBytes(int words)
 {
-	return this->dynMemory;
+	if (this->wordShift >= 0)
+		return words << this->wordShift;
+	return words * this->wordSize;
 }
-int MemoryManager::Memory::getHoleCount()
+void MemoryManagerBase::Memory::publish(uint32_t& slot, uint32_t value)
 {
-	return this->currHoles.size();
+	//Hole arrays and count are read by snapshot threads, so they're stored atomically (a plain mov on x86)
+	__atomic_store_n(&slot, value, __ATOMIC_RELAXED);
 }
-int MemoryManager::Memory::getBlockCount()
+void MemoryManagerBase::Memory::addHole(uint32_t word, uint32_t words)
 {
-	return this->currBlocks.size();
+	//Every hole change goes through addHole/resizeHole/moveHole/removeHole so the dense arrays and the hole index stay in sync
+	uint32_t slot = this->holeCount;
+	this->holeSlot[word] = slot;
+	publish(this->holeStarts[slot], toBytes(word));
+	publish(this->holeSizes[slot], toBytes(words));
+	publish(this->holeCount, slot + 1);
+	this->holeIndex.set(word, words);
 }
-vector<MemoryManager::Memory::Hole>& MemoryManager::Memory::getHoles()
+void MemoryManagerBase::Memory::resizeHole(uint32_t word, uint32_t words)
 {
-	return this->currHoles;
+	publish(this->holeSizes[this->holeSlot[word]], toBytes(words));
+	this->holeIndex.set(word, words);
 }
-vector<MemoryManager::Memory::Block>& MemoryManager::Memory::getBlocks()
+void MemoryManagerBase::Memory::moveHole(uint32_t fromWord, uint32_t toWord, uint32_t words)
 {
-	return this->currBlocks;
+	uint32_t slot = this->holeSlot[fromWord];
+	this->holeSlot[fromWord] = NO_SEGMENT;
+	this->holeSlot[toWord] = slot;
+	publish(this->holeStarts[slot], toBytes(toWord));
+	publish(this->holeSizes[slot], toBytes(words));
+	this->holeIndex.remove(fromWord);
+	this->holeIndex.set(toWord, words);
 }
-void MemoryManager::Memory::setHole(int startBytes, int sizeBytes, uint8_t* addy)
+void MemoryManagerBase::Memory::removeHole(uint32_t word)
 {
-	this->currHoles.push_back(Hole(startBytes, sizeBytes, addy));
+	//the last hole fills the gap, so nothing shifts
+	uint32_t slot = this->holeSlot[word];
+	uint32_t last = this->holeCount - 1;
+	if (slot != last)
+	{
+		publish(this->holeStarts[slot], this->holeStarts[last]);
+		publish(this->holeSizes[slot], this->holeSizes[last]);
+		this->holeSlot[toWords(this->holeStarts[slot])] = slot;
+	}
+	publish(this->holeCount, last);
+	this->holeSlot[word] = NO_SEGMENT;
+	this->holeIndex.remove(word);
 }
-void MemoryManager::Memory::setBlock(int startBytes, int sizeBytes, uint8_t* addy)
+void MemoryManagerBase::Memory::linkAfter(uint32_t word, uint32_t newWord, uint32_t words)
 {
-	this->currBlocks.push_back(Block(startBytes, sizeBytes, addy));
+	//new segment of the given size right after the segment at word
+	this->segmentWords[newWord] = words;
+	this->prevSegment[newWord] = word;
+	this->nextSegment[newWord] = this->nextSegment[word];
+	if (this->nextSegment[word] != NO_SEGMENT)
+		this->prevSegment[this->nextSegment[word]] = newWord;
+	this->nextSegment[word] = newWord;
+}
+void MemoryManagerBase::Memory::unlink(uint32_t word)
+{
+	uint32_t prev = this->prevSegment[word], next = this->nextSegment[word];
+	if (prev != NO_SEGMENT)
+		this->nextSegment[prev] = next;
+	if (next != NO_SEGMENT)
+		this->prevSegment[next] = prev;
+	this->segmentWords[word] = 0;
+	this->nextSegment[word] = NO_SEGMENT;
+	this->prevSegment[word] = NO_SEGMENT;
 }
 
 //Mem Allocation Algorithms
@@ -560,6 +1238,21 @@ int bestFit(int sizeInWords, void* list)
 
 	return bestOffset;
 }
+int firstFit(int sizeInWords, void* list)
+{
+	/*
+	Lowest-addressed hole that fits. MemoryManager recognizes this function and answers it from its hole index
+	in O(log n) without calling it; the linear scan here is for callers that wrap or call it directly.
+	*/
+	int length = ((uint16_t*)list)[0] * 2;
+	for (int i = 2; i <= length; i += 2)
+	{
+		if (((uint16_t*)list)[i] >= sizeInWords)
+			return ((uint16_t*)list)[i - 1];
+	}
+
+	return -1;
+}
 int worstFit(int sizeInWords, void* list)
 {
 	//Same as above, but finds largest possible hole instead.
@@ -577,3 +1270,39 @@ int worstFit(int sizeInWords, void* list)
 
 	return worstOffset;
 }
+NextFit::NextFit()
+{
+	this->cursor = 0;
+}
+int NextFit::operator()(int sizeInWords, void* list)
+{
+	/*
+	Like first fit, but the search starts at the hole the last allocation came from instead of the lowest offset,
+	wrapping around to the start of the list. List holes are in address order, so the resume point is a binary search.
+	*/
+	uint16_t* holeList = (uint16_t*)list;
+	int count = holeList[0];
+
+	//first hole that ends after the cursor
+	int low = 0, high = count;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (holeList[2 * mid + 1] + holeList[2 * mid + 2] > this->cursor)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+
+	for (int n = 0; n < count; n++)
+	{
+		int i = (low + n) % count;
+		if (holeList[2 * i + 2] >= sizeInWords)
+		{
+			this->cursor = holeList[2 * i + 1] + sizeInWords;
+			return holeList[2 * i + 1];
+		}
+	}
+
+	return -1;
+}
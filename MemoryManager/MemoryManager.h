@@ -19,79 +19,653 @@
 #include <algorithm>
 #include <string>
 #include <bitset>
+#include <sys/mman.h>
+#include <climits>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "HoleIndex.h"
+#include "HoleKernels.h"
+#include "RunLengthMap.h"
 using namespace std;
 #pragma once
 
-class MemoryManager
+class TraceRecorder;
+class HeapProfiler;
+
+#define NO_SEGMENT 0xFFFFFFFFu
+
+//Deferred frees: link value of a word that isn't queued, and the queue length at which allocate drains it
+#define NOT_DEFERRED 0xFFFFFFFEu
+#define DEFERRED_FREE_BATCH 64
+
+//Block that contains a pointer, see MemoryManagerBase::findBlock (start is nullptr if no block does)
+struct BlockInfo
+{
+	void* start;
+	size_t sizeBytes;
+};
+
+/*
+	Consistent copy of a manager's holes taken by MemoryManagerBase::takeSnapshot, possibly from another thread
+	while the owner keeps allocating. Same list, bitmap and memory map formats as the manager; the snapshot can be
+	reused, later snapshots keep its buffers.
+*/
+class MemorySnapshot
 {
 public:
-	MemoryManager(unsigned wordSize, std::function<int(int, void*)> allocator);
-	~MemoryManager();
-	void initialize(size_t sizeInWords);
+	MemorySnapshot();
+	uint64_t getVersion();
+	int getHoleCount();
+	int getList(uint16_t* buffer, size_t capacity);
+	void* getBitmap();
+	int getRunLengthMap(uint8_t* buffer, size_t capacity);
+	int dumpMemoryMap(char* filename);
+private:
+	friend class MemoryManagerBase;
+	uint64_t version; //manager's update count when taken, grows with every allocate/free
+	unsigned wordSize;
+	unsigned totalWords;
+	vector<uint32_t> starts; //copy buffers, in bytes
+	vector<uint32_t> sizes;
+	vector<pair<uint32_t, uint32_t>> holes; //(start, size) in words, address order
+};
+
+//Expected lifetime of an allocation: long-lived and permanent blocks are placed from the top of the arena,
+//short-lived ones from the bottom, so long-lived blocks don't pin holes in the middle of short-lived churn
+enum Lifetime : uint8_t
+{
+	LIFETIME_SHORT = 0,
+	LIFETIME_LONG = 1,
+	LIFETIME_PERMANENT = 2
+};
+
+//Word size marker for a BasicMemoryManager whose word size is chosen at runtime
+#define DYNAMIC_WORD_SIZE 0
+
+/*
+	Everything in a memory manager that doesn't depend on the placement policy or on a compile-time word size:
+	the arena, the hole and block lists, free(), tracing and the getters. BasicMemoryManager builds allocate(),
+	getList() and getBitmap() on top of it.
+*/
+class MemoryManagerBase
+{
+public:
+	MemoryManagerBase(unsigned wordSize);
+	//A manager owns its arena, so it can be moved (into containers, to another thread) but not copied
+	MemoryManagerBase(const MemoryManagerBase&) = delete;
+	MemoryManagerBase& operator = (const MemoryManagerBase&) = delete;
+	MemoryManagerBase(MemoryManagerBase&& other);
+	MemoryManagerBase& operator = (MemoryManagerBase&& other);
+	~MemoryManagerBase();
+	int initialize(size_t sizeInWords, unsigned prefaultThreads = 0);
+	//Frees everything and keeps the arena: O(live segments) plus one munmap per large object, not O(1)
+	void reset();
 	void shutdown();
-	void* allocate(size_t sizeInBytes);
 	void free(void* address);
-	void* getList();
+	void freeDeferred(void* address);
+	size_t drainDeferred();
+	size_t getDeferredCount();
+	bool takeSnapshot(MemorySnapshot& snapshot);
+	int dumpMemoryMapAsync(char* filename, std::function<void(int)> callback);
+	int getRunLengthMap(uint8_t* buffer, size_t capacity);
 	unsigned getWordSize();
 	void* getMemoryStart();
 	unsigned getMemoryLimit();
-	void setAllocator(std::function<int(int, void*)> allocator);
-	int dumpMemoryMap(char* filename);
-	void* getBitmap();
-private:
+	int startTrace(char* filename);
+	void stopTrace();
+	void startProfiling(size_t sampleIntervalBytes);
+	void stopProfiling();
+	int writeHeapProfile(char* filename);
+	size_t getProfiledCount();
+	void setMetadataOnly(bool metadataOnly);
+	bool isMetadataOnly();
+	void setLargeObjectThreshold(size_t sizeInBytes);
+	size_t getLargeObjectThreshold();
+	size_t getLargeObjectCount();
+	void setMaintenanceInterval(unsigned milliseconds);
+	unsigned getMaintenanceInterval();
+	size_t maintain();
+	bool owns(void* address);
+	BlockInfo findBlock(void* address);
+	void setInteriorFree(bool interiorFree);
+	bool isInteriorFree();
+	//Holes in no particular order
+	int getHoleCount();
+	int getHoleStartBytes(int index);
+	int getHoleSizeBytes(int index);
+	//Read-only hole access for placement policies. They run inside allocate(), which already holds the maintenance
+	//lock, so none of these take it
+	int getHoleCountUnlocked();
+	const uint32_t* getHoleStarts();
+	const uint32_t* getHoleSizes();
+	HoleIndex& getHoleIndex();
+protected:
+	/*
+		Arena metadata as a fixed pool of segment nodes, allocated once in the constructor. The arena is always
+		split into consecutive segments (holes and blocks); node w describes the segment starting at word w, and
+		nextSegment/prevSegment link the segments in address order. A free finds its neighbours through those
+		links, so every split and coalesce is O(1) and never allocates.
+		Holes are also kept in two dense arrays (struct of arrays, in no particular order) for size scans.
+	*/
 	struct Memory
 	{
-		struct Hole
-		{
-			Hole();
-			Hole(int startBytes, int sizeBytes, uint8_t* addy);
-			bool operator < (const Hole& h) const;
-			int getStartBytes();
-			int getSizeBytes();
-			void setStartBytes(int newStartBytes);
-			void setSizeBytes(int newSizeBytes);
-			uint8_t* getStartAddress();
-			int startBytes;
-			int sizeBytes;
-			uint8_t* address;
-		};
-
-		struct Block
-		{
-			Block();
-			Block(int startBytes, int sizeBytes, uint8_t* addy);
-			int getStartBytes();
-			int getSizeBytes();
-			void setStartBytes(int newStartBytes);
-			void setSizeBytes(int newSizeBytes);
-			uint8_t* getStartAddress();
-			int startBytes;
-			int sizeBytes;
-			uint8_t* address;
-		};
-
 		Memory();
-		Memory(int bytes);
+		Memory(size_t bytes, unsigned wordSize, bool metadataOnly, unsigned prefaultThreads);
+		void release(size_t bytes);
 		void* getMemStart();
+		bool isMetadataOnly();
 		int getHoleCount();
 		int getBlockCount();
-		vector<Hole>& getHoles();
-		vector<Block>& getBlocks();
-		void setHole(int startBytes, int sizeBytes, uint8_t* addy);
-		void setBlock(int startBytes, int sizeBytes, uint8_t* addy);
+		int getHoleStart(int index);
+		int getHoleSize(int index);
+		const uint32_t* getHoleStarts();
+		const uint32_t* getHoleSizes();
+		int copyHoles(uint32_t* starts, uint32_t* sizes);
+		int getHoleCapacity();
+		HoleIndex& getHoleIndex();
+		int getFirstHole();
+		int getNextHole(int holeStartBytes);
+		int getNextSegment(int startBytes);
+		int getSegmentSize(int startBytes);
+		int findHole(int offsetBytes);
+		int findBlock(int offsetBytes);
+		bool isBlockStart(int offsetBytes);
+		void carveBlock(int holeStartBytes, int blockStartBytes, int blockBytes);
+		void releaseBlock(int blockStartBytes);
+		void reset();
+		int toWords(int bytes);
+		int toBytes(int words);
+		void publish(uint32_t& slot, uint32_t value);
+		void addHole(uint32_t word, uint32_t words);
+		void resizeHole(uint32_t word, uint32_t words);
+		void moveHole(uint32_t fromWord, uint32_t toWord, uint32_t words);
+		void removeHole(uint32_t word);
+		void linkAfter(uint32_t word, uint32_t newWord, uint32_t words);
+		void unlink(uint32_t word);
 		uint8_t* dynMemory;
-		vector<Hole> currHoles;
-		vector<Block> currBlocks;
+		unsigned wordSize;
+		int wordShift; //log2(wordSize) for power-of-two word sizes, -1 otherwise
+		bool metadataOnly;
+		//segment node pool, indexed by start word (segmentWords is 0 where no segment starts)
+		vector<uint32_t> segmentWords;
+		vector<uint32_t> nextSegment;
+		vector<uint32_t> prevSegment;
+		vector<uint32_t> holeSlot; //position in holeStarts/holeSizes, NO_SEGMENT for blocks
+		//holes, in bytes, as two parallel arrays so size scans only touch sizes (sized for the worst case, holeCount in use)
+		vector<uint32_t> holeStarts;
+		vector<uint32_t> holeSizes;
+		uint32_t holeCount;
+		int blockCount;
+		HoleIndex holeIndex; //address-ordered, max hole size per subtree (first fit)
+		HoleIndex blockIndex; //same tree over blocks, to find the block containing an interior pointer
 	};
+	void* placeBlock(int blockByteOffset, size_t sizeInBytes, int blockBytes, Lifetime hint);
+	void* failAllocation(size_t sizeInBytes, Lifetime hint);
+	bool isLargeObject(size_t sizeInBytes);
+	void* allocateLarge(size_t sizeInBytes, Lifetime hint);
+	map<void*, size_t>::iterator findLarge(void* address);
+	bool freeLarge(void* address);
+	void releaseLargeObjects();
+	bool releaseAt(int offsetBytes);
+	size_t reclaimDeferred();
+	void discardDeferred();
+	void beginUpdate();
+	void endUpdate();
+	unique_lock<mutex> lockForMaintenance();
+	void startMaintenance();
+	void stopMaintenance();
+	void maintenanceLoop();
+	size_t trimHoles();
 	unsigned wordSize;
 	unsigned totalWords;
-	unsigned bytes;
+	size_t bytes;
 	bool allocated;
+	bool metadataOnly;
+	bool interiorFree;
 	Memory mem;
 	uint16_t* holes;
-	std::function<int(int, void*)> allocator;
+	TraceRecorder* trace;
+	HeapProfiler* profiler; //nullptr unless profiling, so allocate/free pay one pointer test
+	size_t largeObjectThreshold; //0 = every request goes through the arena
+	map<void*, size_t> largeObjects; //directly mapped address -> mapped length, ordered for interior lookups
+	//background maintenance (see setMaintenanceInterval); maintenanceLock guards the arena while the worker runs
+	unsigned maintenanceInterval; //milliseconds between passes, 0 = no worker
+	thread maintainer;
+	mutex maintenanceLock;
+	condition_variable maintenanceWake;
+	bool maintenanceStopping;
+	size_t freesSinceTrim;
+	//deferred frees (see freeDeferred): a lock-free stack of word offsets, linked through one slot per word
+	vector<atomic<uint32_t>> deferredNext; //next queued word, NOT_DEFERRED if the word isn't queued
+	atomic<uint32_t> deferredHead;
+	atomic<size_t> deferredCount;
+	vector<uint32_t> deferredBatch; //drain scratch, reserved at initialize
+	mutex deferredLargeLock;
+	vector<void*> deferredLarge; //deferred frees outside the arena (large objects), behind deferredLargeLock
+	atomic<uint64_t> snapshotVersion; //seqlock over the holes: odd while the owner is changing them
+};
+
+//Word/byte conversions. Division for word sizes only known at runtime (or not a power of two)...
+template<unsigned WordSize, bool PowerOfTwo = (WordSize != 0 && (WordSize & (WordSize - 1)) == 0)>
+struct WordMath
+{
+	static size_t toWords(size_t bytes, unsigned wordSize) { return (bytes + wordSize - 1) / wordSize; }
+	static size_t toBytes(size_t words, unsigned wordSize) { return words * wordSize; }
+};
+
+//...and shifts and masks, folded at compile time, for power-of-two word sizes
+template<unsigned WordSize>
+struct WordMath<WordSize, true>
+{
+	static constexpr unsigned log2(unsigned n) { return n <= 1 ? 0 : 1 + log2(n >> 1); }
+	static const unsigned shift = log2(WordSize);
+	static size_t toWords(size_t bytes, unsigned) { return (bytes + (WordSize - 1)) >> shift; }
+	static size_t toBytes(size_t words, unsigned) { return words << shift; }
+};
+
+/*
+	Memory manager with the placement policy and word size fixed at compile time. The policy's place() is called
+	directly (and inlined) instead of through a std::function, and with a power-of-two WordSize all word rounding
+	is shifts and masks. A policy is any class with
+		template<class Manager> int place(int sizeInWords, Manager& manager);
+	returning the word offset of the hole to use, or -1. Policies may keep state; each manager owns its copy.
+	A policy can also have a placeHigh() with the same signature for long-lived allocations: its choice among the
+	holes seen from the top of the arena. Policies without one place long-lived blocks in the highest hole that fits.
+*/
+template<class Policy, unsigned WordSize>
+class BasicMemoryManager : public MemoryManagerBase
+{
+public:
+	BasicMemoryManager(Policy policy = Policy());
+	BasicMemoryManager(unsigned wordSize, Policy policy);
+	void* allocate(size_t sizeInBytes);
+	void* allocate(size_t sizeInBytes, Lifetime hint);
+	void* getList();
+	int getList(uint16_t* buffer, size_t capacity);
+	int dumpMemoryMap(char* filename);
+	void* getBitmap();
+	Policy& getPolicy();
+	//getList() for placement policies, without the maintenance lock allocate() already holds
+	void* getListUnlocked();
+	int getListUnlocked(uint16_t* buffer, size_t capacity);
+protected:
+	typedef WordMath<WordSize> Words;
+	Policy policy;
 };
 
 //Mem Allocation Algorithms
 int bestFit(int sizeInWords, void* list);
-int worstFit(int sizeInWords, void* list);
\ No newline at end of file
+int firstFit(int sizeInWords, void* list);
+int worstFit(int sizeInWords, void* list);
+
+//Next-fit needs a roving cursor, so it's a function object rather than a plain function.
+//The MemoryManager keeps its own copy, e.g. MemoryManager(8, NextFit()), so each manager has its own cursor.
+class NextFit
+{
+public:
+	NextFit();
+	int operator()(int sizeInWords, void* list);
+private:
+	int cursor; //word offset the next search resumes from
+};
+
+//Placement policies for BasicMemoryManager, answered from the hole metadata without building getList()
+struct FirstFitPolicy
+{
+	template<class Manager> int place(int sizeInWords, Manager& manager)
+	{
+		return manager.getHoleIndex().firstFit(sizeInWords);
+	}
+	template<class Manager> int placeHigh(int sizeInWords, Manager& manager)
+	{
+		return manager.getHoleIndex().lastFit(sizeInWords);
+	}
+};
+
+struct WorstFitPolicy
+{
+	template<class Manager> int place(int sizeInWords, Manager& manager)
+	{
+		return manager.getHoleIndex().worstFit(sizeInWords);
+	}
+	template<class Manager> int placeHigh(int sizeInWords, Manager& manager)
+	{
+		return manager.getHoleIndex().lastWorstFit(sizeInWords);
+	}
+};
+
+struct BestFitPolicy
+{
+	template<class Manager> int place(int sizeInWords, Manager& manager)
+	{
+		//smallest hole that fits, lowest address on ties (same answer as bestFit), from a vectorized scan
+		int bestStart = findBestFit(manager.getHoleSizes(), manager.getHoleStarts(), manager.getHoleCountUnlocked(), sizeInWords * manager.getWordSize());
+		return bestStart < 0 ? -1 : bestStart / (int)manager.getWordSize();
+	}
+	template<class Manager> int placeHigh(int sizeInWords, Manager& manager)
+	{
+		//same size as place() picks, highest address on ties
+		int bestWord = place(sizeInWords, manager);
+		if (bestWord < 0)
+			return -1;
+		uint32_t bestBytes = manager.getHoleIndex().getSize(bestWord) * manager.getWordSize();
+		uint32_t highest = bestWord * manager.getWordSize();
+		const uint32_t* sizes = manager.getHoleSizes();
+		const uint32_t* starts = manager.getHoleStarts();
+		for (int i = 0; i < manager.getHoleCountUnlocked(); i++)
+			if (sizes[i] == bestBytes && starts[i] > highest)
+				highest = starts[i];
+		return highest / manager.getWordSize();
+	}
+};
+
+struct NextFitPolicy
+{
+	NextFitPolicy() : cursor(0) {}
+	template<class Manager> int place(int sizeInWords, Manager& manager)
+	{
+		//same choice as NextFit: first fitting hole that ends after the cursor, wrapping around
+		HoleIndex& index = manager.getHoleIndex();
+		int wordOffset = -1;
+		int straddling = index.lastHoleBefore(this->cursor);
+		if (straddling >= 0 && straddling + (int)index.getSize(straddling) > this->cursor && (int)index.getSize(straddling) >= sizeInWords)
+			wordOffset = straddling;
+		if (wordOffset < 0)
+			wordOffset = index.firstFitFrom(this->cursor, sizeInWords);
+		if (wordOffset < 0)
+			wordOffset = index.firstFit(sizeInWords);
+		if (wordOffset >= 0)
+			this->cursor = wordOffset + sizeInWords;
+		return wordOffset;
+	}
+	int cursor;
+};
+
+//Runtime-configurable policy: any int(int sizeInWords, void* list) allocator called with getList()
+class CallbackPolicy
+{
+public:
+	CallbackPolicy(std::function<int(int, void*)> allocator);
+	template<class Manager> int place(int sizeInWords, Manager& manager)
+	{
+		//the built-in allocators are answered from the hole metadata, no need to build the list
+		if (this->builtin == CALLBACK_FIRST_FIT)
+			return manager.getHoleIndex().firstFit(sizeInWords);
+		if (this->builtin == CALLBACK_BEST_FIT)
+			return this->bestFitPolicy.place(sizeInWords, manager);
+		if (this->builtin == CALLBACK_WORST_FIT)
+			return manager.getHoleIndex().worstFit(sizeInWords);
+
+		void* list = manager.getListUnlocked();
+		int wordOffset = this->allocator(sizeInWords, list);
+		//make sure to free memory from getlist call before allocate terminates
+		delete[] (uint16_t*)list;
+		return wordOffset;
+	}
+	template<class Manager> int placeHigh(int sizeInWords, Manager& manager)
+	{
+		//custom allocators only ever see the real hole list: a stateful one like NextFit keeps offsets between
+		//calls, so it can't be shown the holes from the top. Those get the highest hole that fits instead
+		if (this->builtin == CALLBACK_BEST_FIT)
+			return this->bestFitPolicy.placeHigh(sizeInWords, manager);
+		if (this->builtin == CALLBACK_WORST_FIT)
+			return manager.getHoleIndex().lastWorstFit(sizeInWords);
+		return manager.getHoleIndex().lastFit(sizeInWords);
+	}
+private:
+	enum Builtin
+	{
+		CALLBACK_CUSTOM,
+		CALLBACK_FIRST_FIT,
+		CALLBACK_BEST_FIT,
+		CALLBACK_WORST_FIT
+	};
+	std::function<int(int, void*)> allocator;
+	Builtin builtin; //which of firstFit/bestFit/worstFit the allocator is, if any
+	BestFitPolicy bestFitPolicy;
+};
+
+//Hole for a long-lived allocation: the policy's placeHigh() if it has one, otherwise the highest-addressed hole
+//that fits. Returns the hole's word offset; the block goes at its top end. Call with a last argument of 0.
+template<class Policy, class Manager> auto placeHigh(Policy& policy, int sizeInWords, Manager& manager, int) -> decltype(policy.placeHigh(sizeInWords, manager))
+{
+	return policy.placeHigh(sizeInWords, manager);
+}
+template<class Policy, class Manager> int placeHigh(Policy&, int sizeInWords, Manager& manager, long)
+{
+	return manager.getHoleIndex().lastFit(sizeInWords);
+}
+
+//The original, runtime-configurable memory manager: runtime word size, allocator callback
+class MemoryManager : public BasicMemoryManager<CallbackPolicy, DYNAMIC_WORD_SIZE>
+{
+public:
+	MemoryManager(unsigned wordSize, std::function<int(int, void*)> allocator);
+	void setAllocator(std::function<int(int, void*)> allocator);
+};
+
+//BasicMemoryManager functions (templates, so they live in the header)
+template<class Policy, unsigned WordSize>
+BasicMemoryManager<Policy, WordSize>::BasicMemoryManager(Policy policy) : MemoryManagerBase(WordSize), policy(policy)
+{
+
+}
+template<class Policy, unsigned WordSize>
+BasicMemoryManager<Policy, WordSize>::BasicMemoryManager(unsigned wordSize, Policy policy) : MemoryManagerBase(WordSize ? WordSize : wordSize), policy(policy)
+{
+
+}
+template<class Policy, unsigned WordSize>
+void* BasicMemoryManager<Policy, WordSize>::allocate(size_t sizeInBytes)
+{
+	//If mem isn't initialized or if memory is full, dont perform allocate
+	if (this->bytes == 0)
+		return nullptr;
+	unique_lock<mutex> guard = lockForMaintenance();
+	//Frees queued by other threads are taken in batches, or all at once when the arena looks full
+	if (this->deferredCount.load(memory_order_relaxed) >= DEFERRED_FREE_BATCH)
+		reclaimDeferred();
+	//Requests over the large-object threshold get their own mapping and never touch the arena
+	if (isLargeObject(sizeInBytes))
+		return allocateLarge(sizeInBytes, LIFETIME_SHORT);
+	//0 bytes would be a block of no words, which the segment list can't hold; too big would truncate the word count
+	if (sizeInBytes == 0 || sizeInBytes > this->bytes || (!this->mem.getHoleCount() && !reclaimDeferred()))
+		return failAllocation(sizeInBytes, LIFETIME_SHORT);
+
+	//allocated flag should turn to true once the first allocation happens (used in getList())
+	if (!this->allocated)
+		this->allocated = true;
+
+	//Blocks take whole words so every hole stays word aligned
+	int words = (int)Words::toWords(sizeInBytes, this->wordSize);
+
+	//Ask the policy where to allocate, convert word offset back to bytes offset
+	int wordOffset = this->policy.place(words, *this);
+	if (wordOffset < 0 && reclaimDeferred())
+		wordOffset = this->policy.place(words, *this);
+
+	//No hole fits the request
+	if (wordOffset < 0)
+		return failAllocation(sizeInBytes, LIFETIME_SHORT);
+
+	return placeBlock((int)Words::toBytes(wordOffset, this->wordSize), sizeInBytes, (int)Words::toBytes(words, this->wordSize), LIFETIME_SHORT);
+}
+template<class Policy, unsigned WordSize>
+void* BasicMemoryManager<Policy, WordSize>::allocate(size_t sizeInBytes, Lifetime hint)
+{
+	//Short-lived allocations are ordinary ones, from the bottom of the arena
+	if (hint == LIFETIME_SHORT)
+		return allocate(sizeInBytes);
+
+	if (this->bytes == 0)
+		return nullptr;
+	unique_lock<mutex> guard = lockForMaintenance();
+	if (this->deferredCount.load(memory_order_relaxed) >= DEFERRED_FREE_BATCH)
+		reclaimDeferred();
+	if (isLargeObject(sizeInBytes))
+		return allocateLarge(sizeInBytes, hint);
+	if (sizeInBytes == 0 || sizeInBytes > this->bytes || (!this->mem.getHoleCount() && !reclaimDeferred()))
+		return failAllocation(sizeInBytes, hint);
+	if (!this->allocated)
+		this->allocated = true;
+
+	int words = (int)Words::toWords(sizeInBytes, this->wordSize);
+
+	//Long-lived: the policy picks among holes seen from the top. Permanent: always the highest hole that fits,
+	//so permanent blocks pack against the end of the arena.
+	int holeWord = -1;
+	for (int attempt = 0; attempt < 2 && holeWord < 0; attempt++)
+	{
+		if (attempt == 1 && !reclaimDeferred())
+			break;
+		if (hint == LIFETIME_PERMANENT)
+			holeWord = this->mem.getHoleIndex().lastFit(words);
+		else
+			holeWord = placeHigh(this->policy, words, *this, 0);
+	}
+	if (holeWord < 0)
+		return failAllocation(sizeInBytes, hint);
+
+	//the block takes the top end of the hole
+	int wordOffset = holeWord + (int)this->mem.getHoleIndex().getSize(holeWord) - words;
+	return placeBlock((int)Words::toBytes(wordOffset, this->wordSize), sizeInBytes, (int)Words::toBytes(words, this->wordSize), hint);
+}
+template<class Policy, unsigned WordSize>
+void* BasicMemoryManager<Policy, WordSize>::getList()
+{
+	//the maintenance worker's reclaims change the holes, so the list is read under its lock
+	unique_lock<mutex> guard = lockForMaintenance();
+	return getListUnlocked();
+}
+template<class Policy, unsigned WordSize>
+int BasicMemoryManager<Policy, WordSize>::getList(uint16_t* buffer, size_t capacity)
+{
+	unique_lock<mutex> guard = lockForMaintenance();
+	return getListUnlocked(buffer, capacity);
+}
+template<class Policy, unsigned WordSize>
+void* BasicMemoryManager<Policy, WordSize>::getListUnlocked()
+{
+	//If mem isn't initialized or if no memory has been allocated, dont perform getList
+	if (this->bytes == 0 || !this->allocated)
+		return nullptr;
+
+	//uint16_t* holes dynamically allocates an array of size [hole count * 2 + 1] with the information stored in the hole arrays
+	size_t length = (this->mem.getHoleCount() * 2) + 1;
+	this->holes = new uint16_t[length];
+	getListUnlocked(this->holes, length);
+	return this->holes;
+}
+template<class Policy, unsigned WordSize>
+int BasicMemoryManager<Policy, WordSize>::getListUnlocked(uint16_t* buffer, size_t capacity)
+{
+	/*
+	Same list as getList(), written into a caller-supplied buffer so monitoring doesn't allocate.
+	Returns the number of uint16_t entries the list takes (2 * holes + 1); the buffer is only filled in if
+	capacity is at least that. Returns -1 if mem isn't initialized or nothing has been allocated yet.
+	*/
+	if (this->bytes == 0 || !this->allocated)
+		return -1;
+	int count = this->mem.getHoleCount();
+	int length = (count * 2) + 1;
+	if (capacity < (size_t)length)
+		return length;
+
+	//walking the segment links gives the holes in address order: offset = (startBytes / wordSize), length = sizeBytes / wordSize
+	buffer[0] = (uint16_t)count;
+	int start = this->mem.getFirstHole();
+	for (int j = 0; j < count; j++)
+	{
+		//Odd index elements are always the hole offsets, even index elements are always the hole lengths
+		buffer[(2 * j) + 1] = (uint16_t)Words::toWords(start, this->wordSize);
+		buffer[(2 * j) + 2] = (uint16_t)Words::toWords(this->mem.getSegmentSize(start), this->wordSize);
+		start = this->mem.getNextHole(start);
+	}
+	return length;
+}
+template<class Policy, unsigned WordSize>
+int BasicMemoryManager<Policy, WordSize>::dumpMemoryMap(char* filename)
+{ 
+	/*
+	Prints out current list of holes to a file. You must use POSIX calls, you cannot use fstream objects.
+	Use open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777) to create, enable read-write, and truncate
+	the file on creation. Remember to call close on the file descriptor before ending the function, or
+	your changes may not save.
+	*/
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0777);
+
+	//Error opening file
+	if (fd == -1)
+		return -1;
+	
+	//Write data to file (temp.front().c_str(), strlen(temp.front().c_str()))
+	//(getList() takes the maintenance lock, the rest only reads the copy)
+	getList();
+	int length = this->holes[0] * 2;
+	string data = "";
+	data += "[" + to_string(this->holes[1]) + ", " + to_string(this->holes[2]);
+	for (int i = 3; i < length; i += 2)
+	{
+		data += "] - [" + to_string(this->holes[i]) + ", " + to_string(this->holes[i + 1]);
+	}
+	//delete dynamic Holes array
+	delete[] this->holes;
+	data += "]";
+	ssize_t bytesWritten = write(fd, data.c_str(), strlen(data.c_str()));
+	
+	//Error writing to file
+	if (bytesWritten == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	
+	//close the file (-1 if error closing file)
+	if (close(fd) == -1)
+		return -1;
+
+	return 0;
+}
+template<class Policy, unsigned WordSize>
+void* BasicMemoryManager<Policy, WordSize>::getBitmap()
+{
+	//If mem isn't initialized, dont perform getBitmap
+	if (this->bytes == 0)
+		return nullptr;
+	unique_lock<mutex> guard = lockForMaintenance();
+
+	//Built from the hole list rather than the memory bytes, so it also works in metadata-only mode
+	//and isn't fooled by blocks whose contents happen to be zero.
+	//Two little-endian size bytes, then one bit per word (LSB first): 1 = block, 0 = hole
+	int mapBytes = (this->totalWords + 7) / 8;
+	uint8_t* bitWordMap = new uint8_t[mapBytes + 2];
+	bitWordMap[0] = (uint8_t)(mapBytes & 0xFF);
+	bitWordMap[1] = (uint8_t)(mapBytes >> 8);
+	uint8_t* map = bitWordMap + 2;
+
+	//every word starts out as a block, unused bits of the last byte stay 0
+	memset(map, 0xFF, mapBytes);
+	if (this->totalWords % 8 != 0)
+		map[mapBytes - 1] = (uint8_t)((1 << (this->totalWords % 8)) - 1);
+
+	//clear the words covered by each hole (same rounding as getList)
+	for (int i = 0; i < this->mem.getHoleCount(); i++)
+	{
+		size_t firstWord = Words::toWords(this->mem.getHoleStart(i), this->wordSize);
+		size_t endWord = firstWord + Words::toWords(this->mem.getHoleSize(i), this->wordSize);
+		if (endWord > this->totalWords)
+			endWord = this->totalWords;
+		for (size_t w = firstWord; w < endWord; w++)
+			map[w >> 3] &= (uint8_t)~(1 << (w & 7));
+	}
+
+	return bitWordMap;
+}
+template<class Policy, unsigned WordSize>
+Policy& BasicMemoryManager<Policy, WordSize>::getPolicy()
+{
+	return this->policy;
+}
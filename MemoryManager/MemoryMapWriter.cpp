@@ -0,0 +1,96 @@
+#include "MemoryMapWriter.h"
+
+MemoryMapWriter::MemoryMapWriter(unsigned threadCount, unsigned queueCapacity)
+{
+	if (threadCount == 0)
+		threadCount = 1;
+	this->jobs.resize(queueCapacity);
+	for (unsigned i = 0; i < queueCapacity; i++)
+		this->freeJobs.push_back(queueCapacity - 1 - i);
+	this->busyJobs = 0;
+	this->stopping = false;
+	for (unsigned i = 0; i < threadCount; i++)
+		this->writers.push_back(thread(&MemoryMapWriter::writerLoop, this));
+}
+MemoryMapWriter::~MemoryMapWriter()
+{
+	//dumps already queued are still written
+	waitIdle();
+	{
+		lock_guard<mutex> guard(this->lock);
+		this->stopping = true;
+	}
+	this->ready.notify_all();
+	for (size_t i = 0; i < this->writers.size(); i++)
+		this->writers[i].join();
+}
+int MemoryMapWriter::submit(MemoryManagerBase& manager, char* filename, std::function<void(int)> callback)
+{
+	unsigned slot;
+	{
+		lock_guard<mutex> guard(this->lock);
+		if (this->freeJobs.empty())
+			return -1;
+		slot = this->freeJobs.back();
+		this->freeJobs.pop_back();
+		this->busyJobs++;
+	}
+
+	//the slot is ours until it's queued, so the copy happens outside the lock
+	Job& job = this->jobs[slot];
+	if (!manager.takeSnapshot(job.snapshot))
+	{
+		lock_guard<mutex> guard(this->lock);
+		this->freeJobs.push_back(slot);
+		this->busyJobs--;
+		return -1;
+	}
+	job.filename = filename;
+	job.callback = callback;
+	{
+		lock_guard<mutex> guard(this->lock);
+		this->readyJobs.push_back(slot);
+	}
+	this->ready.notify_one();
+	return 0;
+}
+void MemoryMapWriter::waitIdle()
+{
+	unique_lock<mutex> guard(this->lock);
+	this->idle.wait(guard, [this]() { return this->busyJobs == 0; });
+}
+unsigned MemoryMapWriter::getQueueCapacity()
+{
+	return this->jobs.size();
+}
+MemoryMapWriter& MemoryMapWriter::getShared()
+{
+	static MemoryMapWriter writer(2, 16);
+	return writer;
+}
+void MemoryMapWriter::writerLoop()
+{
+	unique_lock<mutex> guard(this->lock);
+	for (;;)
+	{
+		this->ready.wait(guard, [this]() { return this->stopping || !this->readyJobs.empty(); });
+		if (this->readyJobs.empty())
+			return;
+		unsigned slot = this->readyJobs.front();
+		this->readyJobs.pop_front();
+
+		//format, write and report without holding the lock
+		guard.unlock();
+		Job& job = this->jobs[slot];
+		int result = job.snapshot.dumpMemoryMap((char*)job.filename.c_str());
+		if (job.callback)
+			job.callback(result);
+		job.callback = nullptr;
+		guard.lock();
+
+		this->freeJobs.push_back(slot);
+		this->busyJobs--;
+		if (this->busyJobs == 0)
+			this->idle.notify_all();
+	}
+}
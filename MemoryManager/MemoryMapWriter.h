@@ -0,0 +1,44 @@
+/*
+	Background writer for memory map dumps (see MemoryManagerBase::dumpMemoryMapAsync). The caller only copies the
+	holes into a snapshot; formatting and open/write/close happen on a small pool of writer threads. The queue is a
+	fixed set of job slots, each keeping its snapshot buffers between dumps: when every slot is busy a new dump is
+	refused instead of waited for, so dumping never stalls the allocating thread.
+*/
+
+#include "MemoryManager.h"
+#include <deque>
+#pragma once
+
+class MemoryMapWriter
+{
+public:
+	MemoryMapWriter(unsigned threadCount, unsigned queueCapacity);
+	MemoryMapWriter(const MemoryMapWriter&) = delete;
+	MemoryMapWriter& operator = (const MemoryMapWriter&) = delete;
+	~MemoryMapWriter();
+	//Snapshots manager now and writes the map to filename later; callback gets dumpMemoryMap's result (0 or -1)
+	//on a writer thread. Returns -1 (callback not called) if the manager isn't initialized or the queue is full.
+	int submit(MemoryManagerBase& manager, char* filename, std::function<void(int)> callback);
+	//Blocks until every submitted dump has been written and its callback has returned
+	void waitIdle();
+	unsigned getQueueCapacity();
+	//Writer shared by every manager's dumpMemoryMapAsync (2 threads, 16 slots), started on first use
+	static MemoryMapWriter& getShared();
+private:
+	struct Job
+	{
+		MemorySnapshot snapshot;
+		string filename;
+		std::function<void(int)> callback;
+	};
+	void writerLoop();
+	vector<Job> jobs;
+	vector<unsigned> freeJobs; //slots nobody is using
+	deque<unsigned> readyJobs; //slots waiting for a writer, oldest first
+	unsigned busyJobs; //slots taken by submit() or a writer
+	vector<thread> writers;
+	mutex lock;
+	condition_variable ready;
+	condition_variable idle;
+	bool stopping;
+};
@@ -0,0 +1,118 @@
+/*
+	Standard library adapters so containers can draw from a memory manager arena instead of the global heap:
+	a std::pmr::memory_resource (for std::pmr containers) and a typed allocator (for plain STL containers).
+	Both work with MemoryManager or any BasicMemoryManager, and neither owns the manager. Containers write into
+	what they get, so a metadata-only manager (whose handles can't be dereferenced) can't back them.
+*/
+
+#include "MemoryManager.h"
+#include <memory_resource>
+#include <new>
+#pragma once
+
+//Alignment every block already has: the arena is page aligned and blocks start on word boundaries
+inline size_t getBlockAlignment(unsigned wordSize)
+{
+	size_t lowestBit = wordSize & (~wordSize + 1);
+	return min(lowestBit, (size_t)__STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+//Stricter alignments over-allocate and keep the distance back to the block start in the 4 bytes before the returned pointer
+template<class Manager>
+void* allocateAligned(Manager& manager, size_t bytes, size_t alignment)
+{
+	if (bytes == 0)
+		bytes = 1;
+	if (alignment <= getBlockAlignment(manager.getWordSize()))
+		return manager.allocate(bytes);
+	//the padded size must still fit the manager's int byte counts, and the offset header needs real memory
+	if (alignment > INT_MAX || bytes > INT_MAX - alignment - sizeof(uint32_t) || manager.isMetadataOnly())
+		return nullptr;
+
+	uint8_t* block = (uint8_t*)manager.allocate(bytes + alignment + sizeof(uint32_t));
+	if (!block)
+		return nullptr;
+	uintptr_t aligned = ((uintptr_t)block + sizeof(uint32_t) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	uint32_t distance = (uint32_t)(aligned - (uintptr_t)block);
+	memcpy((uint8_t*)aligned - sizeof(uint32_t), &distance, sizeof(uint32_t));
+	return (void*)aligned;
+}
+template<class Manager>
+void deallocateAligned(Manager& manager, void* p, size_t alignment)
+{
+	if (alignment <= getBlockAlignment(manager.getWordSize()))
+	{
+		manager.free(p);
+		return;
+	}
+	uint32_t distance;
+	memcpy(&distance, (uint8_t*)p - sizeof(uint32_t), sizeof(uint32_t));
+	manager.free((uint8_t*)p - distance);
+}
+
+template<class Manager = MemoryManager>
+class MemoryManagerResource : public std::pmr::memory_resource
+{
+public:
+	MemoryManagerResource(Manager& manager) : manager(&manager) {}
+	Manager& getManager() { return *this->manager; }
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		void* p = allocateAligned(*this->manager, bytes, alignment);
+		//memory_resource has to throw rather than return nullptr when the arena is full
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+	void do_deallocate(void* p, size_t /*bytes*/, size_t alignment) override
+	{
+		deallocateAligned(*this->manager, p, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		const MemoryManagerResource* resource = dynamic_cast<const MemoryManagerResource*>(&other);
+		return resource && resource->manager == this->manager;
+	}
+private:
+	Manager* manager;
+};
+
+//Typed allocator for plain STL containers, e.g. std::vector<int, ManagerAllocator<int>> v(ManagerAllocator<int>(manager))
+template<class T, class Manager = MemoryManager>
+class ManagerAllocator
+{
+public:
+	typedef T value_type;
+	template<class U> struct rebind { typedef ManagerAllocator<U, Manager> other; };
+
+	ManagerAllocator(Manager& manager) noexcept : manager(&manager) {}
+	template<class U> ManagerAllocator(const ManagerAllocator<U, Manager>& other) noexcept : manager(other.manager) {}
+
+	T* allocate(size_t n)
+	{
+		if (n > SIZE_MAX / sizeof(T))
+			throw std::bad_array_new_length();
+		T* p = (T*)allocateAligned(*this->manager, n * sizeof(T), alignof(T));
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+	void deallocate(T* p, size_t /*n*/)
+	{
+		deallocateAligned(*this->manager, p, alignof(T));
+	}
+
+	Manager* manager;
+};
+
+template<class T, class U, class Manager>
+bool operator == (const ManagerAllocator<T, Manager>& a, const ManagerAllocator<U, Manager>& b)
+{
+	return a.manager == b.manager;
+}
+template<class T, class U, class Manager>
+bool operator != (const ManagerAllocator<T, Manager>& a, const ManagerAllocator<U, Manager>& b)
+{
+	return a.manager != b.manager;
+}
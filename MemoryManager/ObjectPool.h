@@ -0,0 +1,206 @@
+/*
+	Fixed-size object pool built on a memory manager. Objects live in chunks allocated from the manager
+	(objectsPerChunk slots each, packed back to back); free slots are chained through their own storage,
+	so create() is a pointer pop and destroy() a pointer push plus a binary search for the owning chunk.
+	A chunk whose objects have all been destroyed goes back to the manager, except one spare kept to
+	avoid allocating and freeing a chunk over and over at a chunk boundary.
+*/
+
+#include "MemoryResource.h"
+#include <utility>
+#pragma once
+
+template<class T, class Manager = MemoryManager>
+class ObjectPool
+{
+public:
+	ObjectPool(Manager& manager, size_t objectsPerChunk = 64);
+	//the pool owns its chunks, a copy would free them a second time
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator = (const ObjectPool&) = delete;
+	~ObjectPool();
+	template<class... Args> T* create(Args&&... args);
+	void destroy(T* object);
+	size_t getLiveCount();
+	size_t getChunkCount();
+private:
+	union Slot
+	{
+		Slot* next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+	struct Chunk
+	{
+		Slot* freeList;
+		Slot* unused; //slots past this one have never been handed out
+		size_t unusedCount;
+		size_t live;
+		Chunk* nextAvailable;
+		Chunk* prevAvailable;
+		bool available;
+	};
+
+	Chunk* newChunk();
+	void releaseChunk(Chunk* chunk);
+	Chunk* findChunk(void* object);
+	Slot* getSlots(Chunk* chunk);
+	void pushAvailable(Chunk* chunk);
+	void removeAvailable(Chunk* chunk);
+
+	Manager* manager;
+	size_t objectsPerChunk;
+	size_t slotOffset; //bytes from the chunk header to the first slot
+	size_t live;
+	Chunk* available; //chunks with at least one free slot
+	Chunk* spare;
+	vector<Chunk*> chunks; //sorted by address, to find the chunk that owns an object
+};
+
+template<class T, class Manager>
+ObjectPool<T, Manager>::ObjectPool(Manager& manager, size_t objectsPerChunk)
+{
+	this->manager = &manager;
+	this->objectsPerChunk = objectsPerChunk ? objectsPerChunk : 1;
+	this->slotOffset = (sizeof(Chunk) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+	this->live = 0;
+	this->available = nullptr;
+	this->spare = nullptr;
+}
+template<class T, class Manager>
+ObjectPool<T, Manager>::~ObjectPool()
+{
+	//Objects still alive are not destructed, their memory just goes back with the chunks
+	for (size_t i = 0; i < this->chunks.size(); i++)
+		deallocateAligned(*this->manager, this->chunks[i], max(alignof(Chunk), alignof(Slot)));
+}
+template<class T, class Manager>
+template<class... Args>
+T* ObjectPool<T, Manager>::create(Args&&... args)
+{
+	Chunk* chunk = this->available;
+	if (!chunk)
+	{
+		chunk = newChunk();
+		if (!chunk)
+			return nullptr;
+	}
+	if (chunk == this->spare)
+		this->spare = nullptr;
+
+	//pop a recycled slot, or hand out the next never-used one
+	Slot* slot = chunk->freeList;
+	if (slot)
+		chunk->freeList = slot->next;
+	else
+	{
+		slot = chunk->unused++;
+		chunk->unusedCount--;
+	}
+	chunk->live++;
+	this->live++;
+	if (!chunk->freeList && !chunk->unusedCount)
+		removeAvailable(chunk);
+
+	return new (slot->storage) T(std::forward<Args>(args)...);
+}
+template<class T, class Manager>
+void ObjectPool<T, Manager>::destroy(T* object)
+{
+	if (!object)
+		return;
+	Chunk* chunk = findChunk(object);
+	if (!chunk)
+		return;
+
+	object->~T();
+	Slot* slot = (Slot*)object;
+	slot->next = chunk->freeList;
+	chunk->freeList = slot;
+	chunk->live--;
+	this->live--;
+	if (!chunk->available)
+		pushAvailable(chunk);
+
+	//Wholly empty: give it back, unless it's the one spare
+	if (chunk->live == 0)
+	{
+		if (!this->spare)
+			this->spare = chunk;
+		else
+			releaseChunk(chunk);
+	}
+}
+template<class T, class Manager>
+size_t ObjectPool<T, Manager>::getLiveCount()
+{
+	return this->live;
+}
+template<class T, class Manager>
+size_t ObjectPool<T, Manager>::getChunkCount()
+{
+	return this->chunks.size();
+}
+template<class T, class Manager>
+typename ObjectPool<T, Manager>::Chunk* ObjectPool<T, Manager>::newChunk()
+{
+	size_t bytes = this->slotOffset + this->objectsPerChunk * sizeof(Slot);
+	Chunk* chunk = (Chunk*)allocateAligned(*this->manager, bytes, max(alignof(Chunk), alignof(Slot)));
+	if (!chunk)
+		return nullptr;
+
+	chunk->freeList = nullptr;
+	chunk->unused = getSlots(chunk);
+	chunk->unusedCount = this->objectsPerChunk;
+	chunk->live = 0;
+	chunk->available = false;
+	pushAvailable(chunk);
+	this->chunks.insert(upper_bound(this->chunks.begin(), this->chunks.end(), chunk), chunk);
+	return chunk;
+}
+template<class T, class Manager>
+void ObjectPool<T, Manager>::releaseChunk(Chunk* chunk)
+{
+	removeAvailable(chunk);
+	this->chunks.erase(lower_bound(this->chunks.begin(), this->chunks.end(), chunk));
+	deallocateAligned(*this->manager, chunk, max(alignof(Chunk), alignof(Slot)));
+}
+template<class T, class Manager>
+typename ObjectPool<T, Manager>::Chunk* ObjectPool<T, Manager>::findChunk(void* object)
+{
+	//last chunk starting at or before the object, if the object is inside its slots
+	typename vector<Chunk*>::iterator it = upper_bound(this->chunks.begin(), this->chunks.end(), (Chunk*)object);
+	if (it == this->chunks.begin())
+		return nullptr;
+	Chunk* chunk = *(it - 1);
+	if ((Slot*)object >= getSlots(chunk) + this->objectsPerChunk)
+		return nullptr;
+	return chunk;
+}
+template<class T, class Manager>
+typename ObjectPool<T, Manager>::Slot* ObjectPool<T, Manager>::getSlots(Chunk* chunk)
+{
+	return (Slot*)((uint8_t*)chunk + this->slotOffset);
+}
+template<class T, class Manager>
+void ObjectPool<T, Manager>::pushAvailable(Chunk* chunk)
+{
+	chunk->available = true;
+	chunk->prevAvailable = nullptr;
+	chunk->nextAvailable = this->available;
+	if (this->available)
+		this->available->prevAvailable = chunk;
+	this->available = chunk;
+}
+template<class T, class Manager>
+void ObjectPool<T, Manager>::removeAvailable(Chunk* chunk)
+{
+	if (!chunk->available)
+		return;
+	if (chunk->prevAvailable)
+		chunk->prevAvailable->nextAvailable = chunk->nextAvailable;
+	else
+		this->available = chunk->nextAvailable;
+	if (chunk->nextAvailable)
+		chunk->nextAvailable->prevAvailable = chunk->prevAvailable;
+	chunk->available = false;
+}
@@ -0,0 +1,88 @@
+/*
+	Bump-pointer region carved out of one memory manager block, for scratch memory that dies all at once.
+	allocate() is an align-and-increment, mark()/resetTo() roll back to an earlier point and releaseAll() empties
+	the region, all O(1) no matter how many objects were allocated. Nothing is destructed: use it for trivially
+	destructible data, or destroy objects yourself before rolling back over them.
+*/
+
+#include "MemoryManager.h"
+#pragma once
+
+template<class Manager = MemoryManager>
+class Region
+{
+public:
+	Region(Manager& manager, size_t bytes);
+	Region(const Region&) = delete;
+	Region& operator = (const Region&) = delete;
+	~Region();
+	void* allocate(size_t bytes, size_t alignment = alignof(max_align_t));
+	size_t mark();
+	void resetTo(size_t mark);
+	void releaseAll();
+	size_t getUsed();
+	size_t getCapacity();
+private:
+	Manager* manager;
+	uint8_t* start;
+	size_t capacity;
+	size_t used;
+};
+
+template<class Manager>
+Region<Manager>::Region(Manager& manager, size_t bytes)
+{
+	//One block from the manager backs the whole region, capacity is 0 if the manager couldn't provide it
+	this->manager = &manager;
+	this->start = (uint8_t*)manager.allocate(bytes);
+	this->capacity = this->start ? bytes : 0;
+	this->used = 0;
+}
+template<class Manager>
+Region<Manager>::~Region()
+{
+	if (this->start)
+		this->manager->free(this->start);
+}
+template<class Manager>
+void* Region<Manager>::allocate(size_t bytes, size_t alignment)
+{
+	//alignment is relative to the real address, the block itself may only be word aligned
+	uintptr_t current = (uintptr_t)this->start + this->used;
+	uintptr_t aligned = (current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (!this->start || aligned < current)
+		return nullptr;
+	//compare against what's left instead of adding, a huge request would wrap the end offset
+	size_t offset = aligned - (uintptr_t)this->start;
+	if (offset > this->capacity || bytes > this->capacity - offset)
+		return nullptr;
+	this->used = offset + bytes;
+	return (void*)aligned;
+}
+template<class Manager>
+size_t Region<Manager>::mark()
+{
+	return this->used;
+}
+template<class Manager>
+void Region<Manager>::resetTo(size_t mark)
+{
+	//everything allocated after mark() returned this value is gone
+	if (mark < this->used)
+		this->used = mark;
+}
+template<class Manager>
+void Region<Manager>::releaseAll()
+{
+	this->used = 0;
+}
+template<class Manager>
+size_t Region<Manager>::getUsed()
+{
+	return this->used;
+}
+template<class Manager>
+size_t Region<Manager>::getCapacity()
+{
+	return this->capacity;
+}
@@ -0,0 +1,56 @@
+#include "RunLengthMap.h"
+
+void putRunLengthValue(uint8_t* buffer, size_t capacity, size_t& length, uint32_t value)
+{
+	//7 bits per byte, low bits first, high bit set on every byte but the last
+	do
+	{
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value)
+			byte |= 0x80;
+		if (length < capacity)
+			buffer[length] = byte;
+		length++;
+	} while (value);
+}
+static bool getRunLengthValue(const uint8_t* data, size_t length, size_t& position, uint32_t& value)
+{
+	value = 0;
+	for (unsigned shift = 0; shift < 35; shift += 7)
+	{
+		if (position >= length)
+			return false;
+		uint8_t byte = data[position++];
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+int decodeRunLengthMap(const uint8_t* data, size_t length, std::vector<uint8_t>& bitmap)
+{
+	size_t position = 0;
+	uint32_t totalWords, holeCount;
+	if (!getRunLengthValue(data, length, position, totalWords) || !getRunLengthValue(data, length, position, holeCount))
+		return -1;
+	if (totalWords > 0x7FFFFFFF || holeCount > totalWords)
+		return -1;
+
+	//start from all holes and fill in the block runs
+	bitmap.assign((totalWords + 7) / 8, 0);
+	uint32_t word = 0;
+	for (uint32_t run = 0; run < 2 * holeCount + 1; run++)
+	{
+		uint32_t words;
+		if (!getRunLengthValue(data, length, position, words) || words > totalWords - word)
+			return -1;
+		if (run % 2 == 0)
+			for (uint32_t w = word; w < word + words; w++)
+				bitmap[w >> 3] |= (uint8_t)(1 << (w & 7));
+		word += words;
+	}
+	if (word != totalWords)
+		return -1;
+	return totalWords;
+}
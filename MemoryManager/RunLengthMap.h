@@ -0,0 +1,18 @@
+/*
+	Run-length occupancy maps: the same information as getBitmap(), but sized by the number of holes instead of the
+	number of words. Every number is an unsigned LEB128 varint:
+		totalWords, holeCount, then 2 * holeCount + 1 run lengths in words
+	alternating block, hole, block, ..., block (the first and last block runs may be 0). The runs add up to totalWords.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#pragma once
+
+//Appends value to buffer at length when it fits; length always advances, so the caller learns the size needed
+void putRunLengthValue(uint8_t* buffer, size_t capacity, size_t& length, uint32_t value);
+
+//Expands an encoded map into one bit per word (LSB first, 1 = block), the layout of getBitmap() without its two
+//size bytes. Returns totalWords, or -1 if data is truncated or inconsistent.
+int decodeRunLengthMap(const uint8_t* data, size_t length, std::vector<uint8_t>& bitmap);
@@ -0,0 +1,168 @@
+#include "ShardedMemoryManager.h"
+#include <sched.h>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+//Managers still alive, so threads can drop their slots for destroyed ones (see getCurrentShard)
+struct LiveManagers
+{
+	std::mutex lock;
+	unordered_set<uint64_t> instances;
+	atomic<uint64_t> destroyed; //bumped by every destructor, threads only prune when it has moved
+};
+static LiveManagers& getLiveManagers()
+{
+	static LiveManagers live;
+	return live;
+}
+
+ShardedMemoryManager::ShardedMemoryManager(unsigned shardCount, unsigned wordSize, std::function<int(int, void*)> allocator, ShardAssignment assignment)
+{
+	//0 shards means one per core
+	if (shardCount == 0)
+		shardCount = thread::hardware_concurrency();
+	if (shardCount == 0)
+		shardCount = 1;
+	static atomic<uint64_t> nextInstance(0);
+	this->wordSize = wordSize;
+	this->assignment = assignment;
+	this->instanceId = nextInstance++;
+	this->nextThread = 0;
+	LiveManagers& live = getLiveManagers();
+	lock_guard<std::mutex> guard(live.lock);
+	live.instances.insert(this->instanceId);
+	for (unsigned i = 0; i < shardCount; i++)
+		this->shards.push_back(new Shard(wordSize, allocator));
+}
+ShardedMemoryManager::~ShardedMemoryManager()
+{
+	shutdown();
+	for (size_t i = 0; i < this->shards.size(); i++)
+		delete this->shards[i];
+	LiveManagers& live = getLiveManagers();
+	lock_guard<std::mutex> guard(live.lock);
+	live.instances.erase(this->instanceId);
+	live.destroyed++;
+}
+void ShardedMemoryManager::initialize(size_t sizeInWordsPerShard, unsigned prefaultThreads)
+{
+	//Not thread safe: initialize before handing the manager to other threads
+	this->ranges.clear();
+	for (unsigned i = 0; i < this->shards.size(); i++)
+	{
+		MemoryManager& manager = this->shards[i]->manager;
+		manager.initialize(sizeInWordsPerShard, prefaultThreads);
+		if (manager.getMemoryStart())
+			this->ranges.push_back(make_pair((uint8_t*)manager.getMemoryStart(), i));
+	}
+	sort(this->ranges.begin(), this->ranges.end());
+}
+void ShardedMemoryManager::shutdown()
+{
+	for (size_t i = 0; i < this->shards.size(); i++)
+		this->shards[i]->manager.shutdown();
+	this->ranges.clear();
+}
+void* ShardedMemoryManager::allocate(size_t sizeInBytes)
+{
+	//Own shard first, then the others in turn so one full shard doesn't fail requests the rest could serve
+	unsigned home = getCurrentShard();
+	for (unsigned i = 0; i < this->shards.size(); i++)
+	{
+		Shard* shard = this->shards[(home + i) % this->shards.size()];
+		lock_guard<std::mutex> guard(shard->lock);
+		void* p = shard->manager.allocate(sizeInBytes);
+		if (p)
+			return p;
+	}
+	return nullptr;
+}
+void ShardedMemoryManager::free(void* address)
+{
+	int index = findShard(address);
+	if (index >= 0)
+	{
+		Shard* shard = this->shards[index];
+		lock_guard<std::mutex> guard(shard->lock);
+		shard->manager.free(address);
+		return;
+	}
+	//outside every arena: a large object has its own mapping, so ask each shard's large-object table
+	for (size_t i = 0; i < this->shards.size(); i++)
+	{
+		Shard* shard = this->shards[i];
+		lock_guard<std::mutex> guard(shard->lock);
+		if (shard->manager.getLargeObjectCount() && shard->manager.owns(address))
+		{
+			shard->manager.free(address);
+			return;
+		}
+	}
+}
+unsigned ShardedMemoryManager::getWordSize()
+{
+	return this->wordSize;
+}
+size_t ShardedMemoryManager::getMemoryLimit()
+{
+	size_t total = 0;
+	for (size_t i = 0; i < this->shards.size(); i++)
+		total += this->shards[i]->manager.getMemoryLimit();
+	return total;
+}
+unsigned ShardedMemoryManager::getShardCount()
+{
+	return this->shards.size();
+}
+unsigned ShardedMemoryManager::getCurrentShard()
+{
+	//Shard the calling thread allocates from first
+	if (this->assignment == SHARD_BY_CPU)
+	{
+		int cpu = sched_getcpu();
+		if (cpu >= 0)
+			return cpu % this->shards.size();
+	}
+	//each manager numbers its own threads; a thread keeps one small entry per manager it has allocated from
+	thread_local unordered_map<uint64_t, unsigned> threadSlots;
+	thread_local uint64_t destroyedSeen = 0;
+	unordered_map<uint64_t, unsigned>::iterator slot = threadSlots.find(this->instanceId);
+	if (slot == threadSlots.end())
+	{
+		//before adding an entry, drop the ones for managers destroyed since this thread last looked,
+		//so a thread's map never holds more than the managers alive the last time it got a new slot
+		LiveManagers& live = getLiveManagers();
+		uint64_t destroyed = live.destroyed;
+		if (destroyed != destroyedSeen)
+		{
+			lock_guard<std::mutex> guard(live.lock);
+			for (unordered_map<uint64_t, unsigned>::iterator entry = threadSlots.begin(); entry != threadSlots.end();)
+			{
+				if (live.instances.count(entry->first))
+					entry++;
+				else
+					entry = threadSlots.erase(entry);
+			}
+			destroyedSeen = destroyed;
+		}
+		slot = threadSlots.emplace(this->instanceId, this->nextThread++).first;
+	}
+	return slot->second % this->shards.size();
+}
+MemoryManager& ShardedMemoryManager::getShard(unsigned index)
+{
+	return this->shards[index]->manager;
+}
+int ShardedMemoryManager::findShard(void* address)
+{
+	//last arena starting at or before address, if address falls inside it
+	vector<pair<uint8_t*, unsigned>>::iterator it = upper_bound(this->ranges.begin(), this->ranges.end(), make_pair((uint8_t*)address, ~0u));
+	if (it == this->ranges.begin())
+		return -1;
+	it--;
+	if ((uint8_t*)address >= it->first + this->shards[it->second]->manager.getMemoryLimit())
+		return -1;
+	return it->second;
+}
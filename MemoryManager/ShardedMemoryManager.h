@@ -0,0 +1,52 @@
+/*
+	Front end over N independent MemoryManager arenas so allocation scales with cores. Every arena (shard) has
+	its own lock, holes and hole index; a thread allocates from the shard picked by the CPU it runs on or by
+	its thread, and only falls back to other shards when its own is full. free() can come from any thread: the
+	owning shard is found by address range (arenas don't move after initialize, so that lookup takes no lock).
+	Large objects live outside the arenas; freeing one asks each shard's large-object table in turn.
+*/
+
+#include "MemoryManager.h"
+#include <mutex>
+#include <atomic>
+#pragma once
+
+enum ShardAssignment
+{
+	SHARD_BY_CPU, //sched_getcpu() % shards: threads on the same core share a shard
+	SHARD_BY_THREAD //threads get shards round robin in the order they first allocate from this manager
+};
+
+class ShardedMemoryManager
+{
+public:
+	ShardedMemoryManager(unsigned shardCount, unsigned wordSize, std::function<int(int, void*)> allocator, ShardAssignment assignment = SHARD_BY_CPU);
+	ShardedMemoryManager(const ShardedMemoryManager&) = delete;
+	ShardedMemoryManager& operator = (const ShardedMemoryManager&) = delete;
+	~ShardedMemoryManager();
+	void initialize(size_t sizeInWordsPerShard, unsigned prefaultThreads = 0);
+	void shutdown();
+	void* allocate(size_t sizeInBytes);
+	void free(void* address);
+	unsigned getWordSize();
+	size_t getMemoryLimit();
+	unsigned getShardCount();
+	unsigned getCurrentShard();
+	//Direct access to one arena for inspection, not locked: only use it while no other thread allocates or frees
+	MemoryManager& getShard(unsigned index);
+private:
+	//one cache line per shard so neighbouring locks don't bounce between cores
+	struct alignas(64) Shard
+	{
+		Shard(unsigned wordSize, std::function<int(int, void*)> allocator) : manager(wordSize, allocator) {}
+		MemoryManager manager;
+		std::mutex lock;
+	};
+	int findShard(void* address);
+	unsigned wordSize;
+	ShardAssignment assignment;
+	uint64_t instanceId; //never reused, unlike addresses, so threads can key their slots by it
+	atomic<unsigned> nextThread; //SHARD_BY_THREAD: slot the next new thread gets
+	vector<Shard*> shards;
+	vector<pair<uint8_t*, unsigned>> ranges; //arena start -> shard index, sorted by address
+};
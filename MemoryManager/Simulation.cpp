@@ -0,0 +1,124 @@
+#include "Simulation.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <pthread.h>
+#include <atomic>
+#include <thread>
+#include <iomanip>
+
+vector<SimulationConfig> makeSweep(const vector<pair<string, std::function<int(int, void*)>>>& strategies, const vector<unsigned>& wordSizes, const vector<size_t>& heapSizes)
+{
+	vector<SimulationConfig> configs;
+	for (size_t s = 0; s < strategies.size(); s++)
+		for (size_t w = 0; w < wordSizes.size(); w++)
+			for (size_t h = 0; h < heapSizes.size(); h++)
+			{
+				SimulationConfig config;
+				config.strategy = strategies[s].first;
+				config.allocator = strategies[s].second;
+				config.wordSize = wordSizes[w];
+				config.sizeInWords = heapSizes[h];
+				configs.push_back(config);
+			}
+	return configs;
+}
+
+//Cores this process may run on (its affinity mask, e.g. under taskset or a container's cpuset)
+static vector<int> getAllowedCores()
+{
+	vector<int> cores;
+	cpu_set_t allowed;
+	if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0)
+		for (int core = 0; core < CPU_SETSIZE; core++)
+			if (CPU_ISSET(core, &allowed))
+				cores.push_back(core);
+	return cores;
+}
+
+//Keeps a worker on one core so concurrent replays don't migrate and share caches
+static void pinToCore(thread& worker, int core)
+{
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpus);
+}
+
+int runSimulations(char* traceFile, const vector<SimulationConfig>& configs, unsigned threadCount, size_t sampleInterval, vector<SimulationResult>& results)
+{
+	int fd = open(traceFile, O_RDONLY);
+	if (fd == -1)
+		return -1;
+
+	struct stat info;
+	if (fstat(fd, &info) == -1 || info.st_size == 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	//One shared read-only mapping, every worker replays straight out of the page cache
+	size_t length = info.st_size;
+	void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return -1;
+	madvise(mapping, length, MADV_WILLNEED);
+	const uint8_t* data = (const uint8_t*)mapping;
+
+	results.assign(configs.size(), SimulationResult());
+	vector<int> cores = getAllowedCores();
+	if (threadCount == 0)
+		threadCount = cores.empty() ? 1 : cores.size();
+	if (threadCount > configs.size())
+		threadCount = configs.size();
+
+	//Workers pull the next unclaimed config until none are left
+	atomic<size_t> next(0);
+	vector<thread> workers;
+	for (unsigned t = 0; t < threadCount; t++)
+	{
+		workers.push_back(thread([&]()
+		{
+			for (size_t i = next++; i < configs.size(); i = next++)
+			{
+				results[i].config = configs[i];
+				results[i].report = replayTrace(data, length, configs[i].wordSize, configs[i].sizeInWords, configs[i].allocator, sampleInterval);
+			}
+		}));
+		//(without a mask to go by the workers are left to the scheduler)
+		if (!cores.empty())
+			pinToCore(workers.back(), cores[t % cores.size()]);
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	munmap(mapping, length);
+	return 0;
+}
+void printSimulationTable(const vector<SimulationResult>& results)
+{
+	cout << left << setw(16) << "strategy" << right << setw(6) << "word" << setw(10) << "words"
+		<< setw(14) << "ops/s" << setw(10) << "failures" << setw(14) << "peak in use" << setw(14) << "footprint"
+		<< setw(10) << "avg frag" << setw(10) << "end frag" << endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const SimulationResult& result = results[i];
+		const ReplayReport& report = result.report;
+
+		double averageFragmentation = 0, finalFragmentation = 0;
+		if (!report.fragmentation.empty())
+		{
+			for (size_t j = 0; j < report.fragmentation.size(); j++)
+				averageFragmentation += report.fragmentation[j].fragmentation;
+			averageFragmentation /= report.fragmentation.size();
+			finalFragmentation = report.fragmentation.back().fragmentation;
+		}
+
+		cout << left << setw(16) << result.config.strategy << right << setw(6) << report.wordSize << setw(10) << report.sizeInWords
+			<< setw(14) << (size_t)report.opsPerSecond << setw(10) << report.failures << setw(14) << report.peakBytesInUse << setw(14) << report.peakFootprintBytes
+			<< fixed << setprecision(3) << setw(10) << averageFragmentation << setw(10) << finalFragmentation << defaultfloat << endl;
+	}
+}
@@ -0,0 +1,33 @@
+/*
+	Multi-strategy simulation: replays one recorded trace (see AllocationTrace.h) against many MemoryManager
+	configurations at once. The trace is memory-mapped once and shared read-only, and each configuration runs
+	in its own MemoryManager on a worker thread pinned to its own core.
+
+	Allocators run concurrently, so a custom allocator that keeps static state (like a round-robin counter)
+	must not appear in more than one configuration of the same run.
+*/
+
+#include "AllocationTrace.h"
+#pragma once
+
+struct SimulationConfig
+{
+	string strategy;
+	std::function<int(int, void*)> allocator;
+	unsigned wordSize;
+	size_t sizeInWords;
+};
+
+struct SimulationResult
+{
+	SimulationConfig config;
+	ReplayReport report;
+};
+
+//Every combination of strategy, word size and heap size (heap sizes in words, 0 = the size in the trace header)
+vector<SimulationConfig> makeSweep(const vector<pair<string, std::function<int(int, void*)>>>& strategies, const vector<unsigned>& wordSizes, const vector<size_t>& heapSizes);
+
+//Replays the trace against every config using up to threadCount threads (0 = one per core).
+//Results come back in config order. Returns -1 if the trace can't be opened or mapped.
+int runSimulations(char* traceFile, const vector<SimulationConfig>& configs, unsigned threadCount, size_t sampleInterval, vector<SimulationResult>& results);
+void printSimulationTable(const vector<SimulationResult>& results);